@@ -0,0 +1,225 @@
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+//Host benchmark for the renderer. Draws the real info and list screens into
+//the headless backend with a made up installer state and reports frame times
+//for every number of tile workers up to the core count. Pass -png to also dump
+//both screens of every scenario.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "draw.h"
+#include "draw_backend.h"
+#include "ui.h"
+
+#define NUM_ENTRIES 64
+#define NUM_FRAMES 600
+
+//Holding DOWN through a big directory, one entry per frame
+#define SCROLL_ENTRIES 10000
+
+static struct dirent *entries[SCROLL_ENTRIES];
+static struct dirent *noEntries[1];
+static char *installQueue[INSTALL_QUEUE_SIZE];
+static u8 installQueueTarget[INSTALL_QUEUE_SIZE];
+static InstallDevice installDevices[] = { {0, 1, "mlc"}, {1, 1, "usb"} };
+static Surface icon;
+
+static u64 nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void setupState(UIState *ui, int numEntries)
+{
+    memset(ui, 0, sizeof(*ui));
+    
+    for(int i = 0; i < numEntries; i++)
+    {
+        if(!entries[i])
+            entries[i] = calloc(1, sizeof(struct dirent));
+        entries[i]->d_type = i < 8 ? DT_DIR : DT_REG;
+        snprintf(entries[i]->d_name, sizeof(entries[i]->d_name), i < 8 ? "folder%02u" : "package%02u.woomy", i);
+    }
+    
+    installQueue[0] = "package03.woomy";
+    installQueue[1] = "package07.woomy";
+    installQueueTarget[1] = 1;
+    
+    icon.width = 128;
+    icon.height = 128;
+    icon.pixels = malloc(128 * 128 * sizeof(u32));
+    for(int y = 0; y < 128; y++)
+    {
+        for(int x = 0; x < 128; x++)
+            icon.pixels[y*128 + x] = ((u32)(x*2) << 24) | ((u32)(y*2) << 16) | ((u32)(255 - (x+y)/2) << 8) | 0xFF;
+    }
+    
+    ui->listLimit = 21;
+    ui->numEntries = numEntries;
+    //A snapshot of an empty directory has no entry to point at, not even the
+    //selected one
+    ui->entries = numEntries ? entries : noEntries;
+    ui->currentDirectory = "/vol/external01/wiiu/packages/";
+    ui->installDevices = installDevices;
+    ui->installQueue = installQueue;
+    ui->installQueueTarget = installQueueTarget;
+    ui->icon = &icon;
+}
+
+static UILayout layout;
+
+static void drawFrame(const UIState *ui)
+{
+    layoutUI(ui, &layout);
+    for(int screen = SCREEN_TOP; screen <= SCREEN_BOTTOM; screen++)
+    {
+        beginFrame(screen);
+        drawLayout(&layout, screen);
+        endFrame();
+    }
+}
+
+//Scenarios step the state the way the installer would between frames
+static void stepIdle(UIState *ui, int frame)
+{
+}
+
+static void stepBrowse(UIState *ui, int frame)
+{
+    if(frame % 4)
+        return;
+    
+    ui->selectedFile = (ui->selectedFile + 1) % ui->numEntries;
+    if(ui->selectedFile == 0)
+        ui->scrollPos = 0;
+    else if(ui->selectedFile >= ui->scrollPos + ui->listLimit)
+        ui->scrollPos++;
+}
+
+static void stepScroll(UIState *ui, int frame)
+{
+    if(ui->selectedFile < ui->numEntries - 1)
+        ui->selectedFile++;
+    if(ui->selectedFile >= ui->scrollPos + ui->listLimit)
+        ui->scrollPos++;
+}
+
+//The same, with the list repainted completely every frame for comparison
+static void stepScrollRedraw(UIState *ui, int frame)
+{
+    stepScroll(ui, frame);
+    markScreenDirty(ui->screenSwap ? SCREEN_TOP : SCREEN_BOTTOM);
+}
+
+static void stepExtract(UIState *ui, int frame)
+{
+    ui->extracting = true;
+    ui->hasIcon = true;
+    ui->entryName = "Example Title";
+    ui->archiveName = "package03.woomy";
+    ui->extractTotal = 40;
+    ui->extractProg = (frame / 15) % 40;
+}
+
+//Swapping screens repaints both of them completely
+static void stepSwap(UIState *ui, int frame)
+{
+    ui->screenSwap = !ui->screenSwap;
+    ui->listLimit = ui->screenSwap ? 31 : 22;
+}
+
+static void stepInstall(UIState *ui, int frame)
+{
+    ui->installing = true;
+    ui->hasIcon = true;
+    ui->installTid = 0x0005000010101A00ull;
+    ui->currentlyInstalling = "package03.woomy";
+    ui->sizeTotal = 512ull << 20;
+    ui->sizeProgress = ui->sizeTotal * frame / NUM_FRAMES;
+    ui->contentsTotal = 12;
+    ui->contentsProgress = frame * 12 / NUM_FRAMES;
+}
+
+static const struct
+{
+    const char *name;
+    void (*step)(UIState *ui, int frame);
+    bool swap;
+    int entries;
+    int frames;
+} scenarios[] =
+{
+    { "idle", stepIdle, false, NUM_ENTRIES, NUM_FRAMES },
+    { "empty", stepIdle, false, 0, NUM_FRAMES },
+    { "browse", stepBrowse, false, NUM_ENTRIES, NUM_FRAMES },
+    { "browse-swapped", stepBrowse, true, NUM_ENTRIES, NUM_FRAMES },
+    { "scroll", stepScroll, false, SCROLL_ENTRIES, SCROLL_ENTRIES },
+    { "scroll-swapped", stepScroll, true, SCROLL_ENTRIES, SCROLL_ENTRIES },
+    { "scroll-redraw", stepScrollRedraw, false, SCROLL_ENTRIES, SCROLL_ENTRIES },
+    { "extract", stepExtract, false, NUM_ENTRIES, NUM_FRAMES },
+    { "install", stepInstall, false, NUM_ENTRIES, NUM_FRAMES },
+    { "swap", stepSwap, false, NUM_ENTRIES, NUM_FRAMES },
+};
+
+int main(int argc, char **argv)
+{
+    bool dumpPNG = argc > 1 && !strcmp(argv[1], "-png");
+    
+    for(int s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++)
+    {
+        for(int workers = 1; workers <= backendMaxWorkers(); workers++)
+        {
+            UIState ui;
+            setupState(&ui, scenarios[s].entries);
+            ui.screenSwap = scenarios[s].swap;
+            if(ui.screenSwap)
+                ui.listLimit = 31;
+            
+            headlessInit();
+            setDrawWorkers(workers);
+            markScreenDirty(SCREEN_TOP);
+            markScreenDirty(SCREEN_BOTTOM);
+            
+            u64 total = 0, worst = 0;
+            int frames = scenarios[s].frames;
+            for(int frame = 0; frame < frames; frame++)
+            {
+                scenarios[s].step(&ui, frame);
+                
+                u64 start = nowNs();
+                drawFrame(&ui);
+                u64 elapsed = nowNs() - start;
+                
+                total += elapsed;
+                if(elapsed > worst)
+                    worst = elapsed;
+            }
+            
+            printf("%-16s %d cores %8.3f ms/frame avg %8.3f ms worst %9.1f ms total\n", scenarios[s].name, workers, total / 1e6 / frames, worst / 1e6, total / 1e6);
+            
+            if(dumpPNG)
+            {
+                char path[64];
+                snprintf(path, sizeof(path), "%s-%d-tv.png", scenarios[s].name, workers);
+                headlessWritePNG(SCREEN_TOP, path);
+                snprintf(path, sizeof(path), "%s-%d-drc.png", scenarios[s].name, workers);
+                headlessWritePNG(SCREEN_BOTTOM, path);
+            }
+        }
+    }
+    
+    return 0;
+}
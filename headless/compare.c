@@ -0,0 +1,266 @@
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+//Host test for the incremental renderer. Plays a random sequence of installer
+//states through the headless backend, first repainting both screens in full
+//every frame on one worker, then the normal way with only what changed on one
+//and then several workers. Every frame has to come out identical to the full
+//repaint. Exits non-zero on the first one that doesn't, writing both versions
+//of the screen as PNGs.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "draw.h"
+#include "draw_backend.h"
+#include "ui.h"
+
+#define NUM_ENTRIES 3000
+#define NUM_FRAMES 2000
+
+//Enough to split every large repaint into several bands even on a host with
+//fewer cores
+#define TILE_WORKERS 4
+
+static struct dirent *entries[NUM_ENTRIES];
+static struct dirent *noEntries[1];
+static char *installQueue[INSTALL_QUEUE_SIZE];
+static u8 installQueueTarget[INSTALL_QUEUE_SIZE];
+static InstallDevice installDevices[] = { {0, 1, "mlc"}, {1, 1, "usb"} };
+static char *queueNames[] = { "package03.woomy", "a much longer package name.woomy", "folder01/", "x.woomy" };
+static FrameStats frameStats = { 30, 1234, 5678, 33000, true };
+static Surface icon;
+static UILayout layout;
+
+static u32 reference[NUM_FRAMES][2];
+
+//The C library's rand() differs between hosts, this doesn't
+static u32 rngState;
+
+static u32 rng()
+{
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+static void setupState(UIState *ui, int numEntries)
+{
+    memset(ui, 0, sizeof(*ui));
+    memset(installQueue, 0, sizeof(installQueue));
+    
+    for(int i = 0; i < NUM_ENTRIES; i++)
+    {
+        if(!entries[i])
+            entries[i] = calloc(1, sizeof(struct dirent));
+        
+        char name[32];
+        int len = rng() % 24;
+        for(int c = 0; c < len; c++)
+            name[c] = 'a' + rng() % 26;
+        name[len] = 0;
+        entries[i]->d_type = rng() % 5 ? DT_REG : DT_DIR;
+        snprintf(entries[i]->d_name, sizeof(entries[i]->d_name), "%d%s", i, name);
+    }
+    
+    if(!icon.pixels)
+    {
+        icon.width = 128;
+        icon.height = 128;
+        icon.pixels = malloc(128 * 128 * sizeof(u32));
+        for(int y = 0; y < 128; y++)
+        {
+            for(int x = 0; x < 128; x++)
+                icon.pixels[y*128 + x] = ((u32)(x*2) << 24) | ((u32)(y*2) << 16) | ((u32)(255 - (x+y)/2) << 8) | 0xFF;
+        }
+    }
+    
+    ui->listLimit = 22;
+    ui->numEntries = numEntries;
+    //A snapshot of an empty directory has no entry to point at, not even the
+    //selected one
+    ui->entries = numEntries ? entries : noEntries;
+    ui->currentDirectory = "/vol/external01/wiiu/packages/";
+    ui->installDevices = installDevices;
+    ui->installQueue = installQueue;
+    ui->installQueueTarget = installQueueTarget;
+    ui->icon = &icon;
+    ui->entryName = "Example Title";
+    ui->archiveName = "package03.woomy";
+    ui->currentlyInstalling = "package03.woomy";
+    ui->installTid = 0x0005000010101A00ull;
+}
+
+static void keepSelectionVisible(UIState *ui)
+{
+    if(ui->selectedFile < ui->scrollPos)
+        ui->scrollPos = ui->selectedFile;
+    if(ui->selectedFile >= ui->scrollPos + ui->listLimit)
+        ui->scrollPos = ui->selectedFile - ui->listLimit + 1;
+}
+
+//Mostly moving through the list, now and then anything else the installer
+//could change between two frames
+static void step(UIState *ui, int frame)
+{
+    //An empty directory has nothing to move through
+    int r = ui->numEntries ? rng() % 100 : 72 + rng() % 28;
+    if(r < 40)
+        ui->selectedFile = ui->selectedFile < ui->numEntries - 1 ? ui->selectedFile + 1 : 0;
+    else if(r < 65)
+        ui->selectedFile = ui->selectedFile > 0 ? ui->selectedFile - 1 : 0;
+    else if(r < 72)
+        ui->selectedFile = (ui->selectedFile + ui->listLimit) % ui->numEntries;
+    else if(r < 74)
+    {
+        ui->screenSwap = !ui->screenSwap;
+        ui->listLimit = ui->screenSwap ? 31 : 22;
+    }
+    else if(r < 77)
+        ui->buttonState = !ui->buttonState;
+    else if(r < 79)
+        ui->frameStats = ui->frameStats ? NULL : &frameStats;
+    else if(r < 82)
+        ui->selectedInstallTarget = !ui->selectedInstallTarget;
+    else if(r < 85)
+    {
+        int queued = 0;
+        while(installQueue[queued])
+            queued++;
+        if(queued && rng() % 2)
+        {
+            memmove(installQueue, installQueue + 1, queued * sizeof(char*));
+            memmove(installQueueTarget, installQueueTarget + 1, queued);
+        }
+        else if(queued < 4)
+        {
+            installQueue[queued] = queueNames[rng() % 4];
+            installQueueTarget[queued] = rng() % 2;
+        }
+    }
+    else if(r < 88)
+    {
+        ui->extracting = !ui->extracting;
+        ui->hasIcon = ui->extracting || ui->installing;
+    }
+    else if(r < 90)
+    {
+        ui->installing = !ui->installing;
+        ui->hasIcon = ui->extracting || ui->installing;
+    }
+    
+    ui->extractTotal = 40;
+    ui->extractProg = frame / 15 % 40;
+    ui->sizeTotal = 512ull << 20;
+    ui->sizeProgress = ui->sizeTotal * (frame % 600) / 600;
+    ui->contentsTotal = 12;
+    ui->contentsProgress = frame % 600 * 12 / 600;
+    frameStats.renderUs = frame * 7 % 5000;
+    keepSelectionVisible(ui);
+}
+
+//Where the last run went wrong, if it did
+static int failedFrame;
+static int failedScreen;
+
+//Plays the first frames of one seed's sequence. With fullRedraw the sums are
+//recorded, otherwise compared against them.
+static bool run(u32 seed, int numEntries, int workers, bool fullRedraw, int frames)
+{
+    UIState ui;
+    rngState = seed;
+    setupState(&ui, numEntries);
+    
+    headlessInit();
+    setDrawWorkers(workers);
+    markScreenDirty(SCREEN_TOP);
+    markScreenDirty(SCREEN_BOTTOM);
+    
+    for(int frame = 0; frame < frames; frame++)
+    {
+        step(&ui, frame);
+        if(fullRedraw)
+        {
+            markScreenDirty(SCREEN_TOP);
+            markScreenDirty(SCREEN_BOTTOM);
+        }
+        
+        //The TV gets skipped on some frames like it does when the installer
+        //falls behind, leaving it more to catch up on
+        layoutUI(&ui, &layout);
+        for(int screen = SCREEN_TOP; screen <= SCREEN_BOTTOM; screen++)
+        {
+            if(screen == SCREEN_TOP && frame % 7 == 3)
+                continue;
+            beginFrame(screen);
+            drawLayout(&layout, screen);
+            endFrame();
+        }
+        
+        for(int screen = SCREEN_TOP; screen <= SCREEN_BOTTOM; screen++)
+        {
+            u32 sum = headlessChecksum(screen);
+            if(fullRedraw)
+                reference[frame][screen] = sum;
+            else if(sum != reference[frame][screen])
+            {
+                failedFrame = frame;
+                failedScreen = screen;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//Three random walks through a big directory and one through an empty one
+static const struct
+{
+    u32 seed;
+    int entries;
+} sequences[] =
+{
+    { 0x9E3779B9, NUM_ENTRIES },
+    { 0x3C6EF372, NUM_ENTRIES },
+    { 0xDAA66D2B, NUM_ENTRIES },
+    { 0x78DDE6E4, 0 },
+};
+
+int main(int argc, char **argv)
+{
+    static const int workerCounts[] = { 1, TILE_WORKERS };
+    headlessSetMaxWorkers(TILE_WORKERS);
+    
+    for(int s = 0; s < sizeof(sequences) / sizeof(sequences[0]); s++)
+    {
+        u32 seed = sequences[s].seed;
+        int numEntries = sequences[s].entries;
+        run(seed, numEntries, 1, true, NUM_FRAMES);
+        
+        for(int w = 0; w < sizeof(workerCounts) / sizeof(workerCounts[0]); w++)
+        {
+            if(run(seed, numEntries, workerCounts[w], false, NUM_FRAMES))
+            {
+                printf("seed %08x %4d entries %d workers: %d frames match a full repaint\n", seed, numEntries, workerCounts[w], NUM_FRAMES);
+                continue;
+            }
+            
+            printf("seed %08x %4d entries %d workers: frame %d on the %s differs from a full repaint\n", seed, numEntries, workerCounts[w], failedFrame, failedScreen == SCREEN_TOP ? "TV" : "gamepad");
+            headlessWritePNG(failedScreen, "compare-incremental.png");
+            run(seed, numEntries, 1, true, failedFrame + 1);
+            headlessWritePNG(failedScreen, "compare-full.png");
+            return 1;
+        }
+    }
+    
+    return 0;
+}
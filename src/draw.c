@@ -9,19 +9,156 @@
  */
 
 #include "draw.h"
+#include "draw_backend.h"
 
-#include <coreinit/cache.h>
-#include <coreinit/screen.h>
-#include <gx2/display.h>
+#ifdef DRAW_BENCH
+#include <coreinit/debug.h>
+#include <coreinit/time.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-void *screenBufferTop;
-void *screenBufferBottom;
 int activeScreen = 0;
 
+#ifdef DRAW_BENCH
+//Push every pixel through the backend's put pixel call, OSScreenPutPixelEx on
+//the console, like the old renderer did so main can time both paths against
+//the same frames
+bool drawSlowPath = false;
+#endif
+
+//The frame being drawn for each screen, looked up from the backend once per
+//flip. Each screen has two, frame says which one this is.
+static u32 *drawBuffer[2];
+static int drawPitch[2];
+static int drawFrame[2];
+
+//Both frames of each screen as the backend last handed them out, and whether
+//the one on screen still holds exactly the screen's last display list, so a
+//scroll can copy rows out of it
+static u32 *framePointers[2][2];
+static bool frameShown[2];
+
+//Areas that changed and still have to be repainted, kept per screen and per
+//frame since both frames of a screen need the change before it can be skipped.
+//While a frame is being drawn every fill is clipped to its list.
+#define DIRTY_MAX 16
+
+static DirtyRect dirtyRects[2][2][DIRTY_MAX];
+static int numDirty[2][2];
+
+//What the thread drawing is clipped to. Each tile worker replaying a frame
+//gets its own slice of the dirty areas, found by backendWorkerIndex.
+typedef struct ClipState
+{
+    DirtyRect *rects;
+    int num;
+} ClipState;
+
+static ClipState clipStates[DRAW_WORKERS_MAX];
+
+//Below this many dirty pixels waking the workers costs more than it saves
+#define TILE_MIN_AREA (256*256)
+#define TILES_IDLE 0x40000000
+
+//Tiles go to workers only while the other cores are free, see setDrawWorkers
+static int drawWorkers = 1;
+static DirtyRect tileRects[DRAW_WORKERS_MAX][DIRTY_MAX];
+
+//The bands of the frame being replayed. Each worker claims the next one off
+//tileNext until none are left, so a worker whose core is busy with something
+//else just ends up with fewer of them, or none. Between frames tileNext sits
+//far past any band count so a worker waking late finds nothing to do.
+static ClipState tileClips[DRAW_WORKERS_MAX];
+static int tileCount;
+static int tileNext = TILES_IDLE;
+static int tilesDone;
+
+static inline ClipState *currentClip()
+{
+    return &clipStates[backendWorkerIndex()];
+}
+
+//Between beginFrame and endFrame draw calls only record themselves into the
+//screen's display list. endFrame compares it with the last list for that
+//screen and rasterizes just the areas where the two differ.
+#define CMD_FILL        0
+#define CMD_PIXEL       1
+#define CMD_LINE        2
+#define CMD_RECT        3
+#define CMD_RECT_THICK  4
+#define CMD_FILL_RECT   5
+#define CMD_CIRCLE      6
+#define CMD_FILL_CIRCLE 7
+#define CMD_CIRCUM      8
+#define CMD_TEXT        9
+#define CMD_SURFACE     10
+#define CMD_BLEND       11
+
+typedef struct DrawCmd
+{
+    int type;
+    int x1, y1, x2, y2;
+    int arg;
+    u32 color;
+    void *data;
+    u32 text;
+    u32 textLen;
+    u32 hash;
+    DirtyRect bounds;
+    int next;
+    bool matched;
+    
+    //Where the command is compared at after moving with a scroll, and the
+    //hash it has there
+    int matchY1, matchY2;
+    u32 matchHash;
+    
+    //Text layouts looked up before a frame is split into tiles, so workers
+    //never touch the text cache
+    bool resolved;
+    void *layout;
+} DrawCmd;
+
+typedef struct DisplayList
+{
+    DrawCmd *cmds;
+    int numCmds;
+    int maxCmds;
+    char *text;
+    u32 textLen;
+    u32 textMax;
+} DisplayList;
+
+static DisplayList displayLists[2][2];
+static int displayCurrent[2];
+static bool recording = false;
+
+//Set when the display list couldn't grow. The rest of the frame is dropped
+//rather than drawn unclipped and outside the diff.
+static bool recordFailed = false;
+
+//Set by scrollRegion for the frame being recorded
+static bool scrollSet = false;
+static DirtyRect scrollRect;
+static int scrollDy;
+
+static bool recordCmd(int type, int x1, int y1, int x2, int y2, int arg, u32 color, void *data, const char *text);
+static u32 hashBytes(u32 hash, const void *data, u32 len);
+
+//Formatted strings are built on the caller's stack, so every thread drawing
+//text has its own scratch space and nothing is allocated per call
+#define TEXT_MAX 0x500
+
+#define DRAW_COLOR(r,g,b,a) (((u32)(u8)(r) << 24) | ((u32)(u8)(g) << 16) | ((u32)(u8)(b) << 8) | (u8)(a))
+
 u32 getScreenWidth()
 {
     if(activeScreen == 0)
@@ -38,67 +175,251 @@ u32 getScreenHeight()
         return 480;
 }
 
+static u32 *findDrawBuffer()
+{
+    u32 *buf = backendGetFrame(activeScreen, &drawPitch[activeScreen], &drawFrame[activeScreen]);
+    drawBuffer[activeScreen] = buf;
+    framePointers[activeScreen][drawFrame[activeScreen]] = buf;
+    return buf;
+}
+
+static inline u32 *getDrawBuffer()
+{
+    u32 *buf = drawBuffer[activeScreen];
+    return buf ? buf : findDrawBuffer();
+}
+
+static inline void fillPixels(u32 *dst, int len, u32 color)
+{
+    //No vector stores on Espresso, unrolling lets the write-gather pipe
+    //see a steady stream of words
+    while(len >= 8)
+    {
+        dst[0] = color; dst[1] = color; dst[2] = color; dst[3] = color;
+        dst[4] = color; dst[5] = color; dst[6] = color; dst[7] = color;
+        dst += 8;
+        len -= 8;
+    }
+    while(len-- > 0)
+        *dst++ = color;
+}
+
+static inline void fillRun(int x1, int x2, int y, u32 color)
+{
+#ifdef DRAW_BENCH
+    if(drawSlowPath)
+    {
+        for(int x = x1; x <= x2; x++)
+            backendPutPixel(activeScreen, x, y, color);
+        return;
+    }
+#endif
+    
+    u32 *buf = getDrawBuffer();
+    fillPixels(buf + y*drawPitch[activeScreen] + x1, x2 - x1 + 1, color);
+}
+
+//Fills x1..x2 inclusive on row y, clipped to the screen and the dirty areas
+static void drawSpan(int x1, int x2, int y, u32 color)
+{
+    if(x1 > x2)
+    {
+        int t = x1;
+        x1 = x2;
+        x2 = t;
+    }
+    
+    int width = getScreenWidth();
+    if(y < 0 || y >= (int)getScreenHeight() || x2 < 0 || x1 >= width)
+        return;
+    if(x1 < 0)
+        x1 = 0;
+    if(x2 >= width)
+        x2 = width - 1;
+    
+    ClipState *clip = currentClip();
+    if(!clip->rects)
+    {
+        fillRun(x1, x2, y, color);
+        return;
+    }
+    
+    for(int i = 0; i < clip->num; i++)
+    {
+        DirtyRect *r = &clip->rects[i];
+        if(y < r->y1 || y > r->y2)
+            continue;
+        
+        int cx1 = x1 > r->x1 ? x1 : r->x1;
+        int cx2 = x2 < r->x2 ? x2 : r->x2;
+        if(cx1 <= cx2)
+            fillRun(cx1, cx2, y, color);
+    }
+}
+
+//Whether anything in the rectangle would survive clipping
+static bool rectVisible(int x1, int y1, int x2, int y2)
+{
+    ClipState *clip = currentClip();
+    if(!clip->rects)
+        return true;
+    
+    for(int i = 0; i < clip->num; i++)
+    {
+        DirtyRect *r = &clip->rects[i];
+        if(x1 <= r->x2 && x2 >= r->x1 && y1 <= r->y2 && y2 >= r->y1)
+            return true;
+    }
+    return false;
+}
+
+static void addDirty(DirtyRect *rects, int *count, DirtyRect r)
+{
+    //Fold in anything overlapping so the list stays disjoint and nothing gets
+    //filled twice
+    for(int i = 0; i < *count;)
+    {
+        DirtyRect *o = &rects[i];
+        if(r.x1 <= o->x2 && r.x2 >= o->x1 && r.y1 <= o->y2 && r.y2 >= o->y1)
+        {
+            if(o->x1 < r.x1) r.x1 = o->x1;
+            if(o->y1 < r.y1) r.y1 = o->y1;
+            if(o->x2 > r.x2) r.x2 = o->x2;
+            if(o->y2 > r.y2) r.y2 = o->y2;
+            *o = rects[--*count];
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+    
+    if(*count == DIRTY_MAX)
+    {
+        for(int i = 0; i < *count; i++)
+        {
+            if(rects[i].x1 < r.x1) r.x1 = rects[i].x1;
+            if(rects[i].y1 < r.y1) r.y1 = rects[i].y1;
+            if(rects[i].x2 > r.x2) r.x2 = rects[i].x2;
+            if(rects[i].y2 > r.y2) r.y2 = rects[i].y2;
+        }
+        *count = 0;
+    }
+    rects[(*count)++] = r;
+}
+
+void markDirty(int screen, int x1, int y1, int x2, int y2)
+{
+    DirtyRect r;
+    int width = screen == SCREEN_TOP ? 1280 : 854;
+    int height = screen == SCREEN_TOP ? 720 : 480;
+    
+    r.x1 = x1 < x2 ? x1 : x2;
+    r.x2 = x1 < x2 ? x2 : x1;
+    r.y1 = y1 < y2 ? y1 : y2;
+    r.y2 = y1 < y2 ? y2 : y1;
+    if(r.x1 < 0) r.x1 = 0;
+    if(r.y1 < 0) r.y1 = 0;
+    if(r.x2 >= width) r.x2 = width - 1;
+    if(r.y2 >= height) r.y2 = height - 1;
+    if(r.x1 > r.x2 || r.y1 > r.y2)
+        return;
+    
+    for(int frame = 0; frame < 2; frame++)
+        addDirty(dirtyRects[screen][frame], &numDirty[screen][frame], r);
+}
+
+//Also forgets what's on screen, the buffers may not even be the same ones
+void markScreenDirty(int screen)
+{
+    markDirty(screen, 0, 0, 1279, 719);
+    frameShown[screen] = false;
+    framePointers[screen][0] = NULL;
+    framePointers[screen][1] = NULL;
+}
+
 void setActiveScreen(int screen)
 {
     activeScreen = screen;
+    drawBuffer[screen] = NULL;
 }
 
+//Anything drawn outside of beginFrame and endFrame could be anywhere, so this
+//has the whole frame flushed
 void flipBuffers()
 {
-	//Grab the buffer size for each screen (TV and gamepad)
-	int buf0_size = OSScreenGetBufferSizeEx(0);
-	int buf1_size = OSScreenGetBufferSizeEx(1);
-	
-	//Flush the cache
-	if(activeScreen == SCREEN_BOTTOM)
-	    DCFlushRange(screenBufferBottom, buf1_size);
-	else
-	    DCFlushRange(screenBufferTop, buf0_size);
-	
-	//Flip the buffer
-	OSScreenFlipBuffersEx(activeScreen);
+	backendFlip(activeScreen, NULL, 0);
+	drawBuffer[activeScreen] = NULL;
+	frameShown[activeScreen] = false;
+	framePointers[activeScreen][0] = NULL;
+	framePointers[activeScreen][1] = NULL;
 }
 
 void drawOSString(int x, int y, char * string)
 {
-	OSScreenPutFontEx(activeScreen, x, y, string);
+	backendPutFont(activeScreen, x, y, string);
 }
 
 void drawOSStringf(int x, int y, const char *format, ...)
 {
-    char buffer[0x500];
+    char buffer[TEXT_MAX];
     va_list args;
     va_start(args, format);
-    vsnprintf(buffer, 0x500, format, args);
+    vsnprintf(buffer, TEXT_MAX, format, args);
     va_end(args);
     
-	OSScreenPutFontEx(activeScreen, x, y, buffer);
+	backendPutFont(activeScreen, x, y, buffer);
 }
 
 void fillScreen(char r,char g,char b,char a)
 {
-	uint32_t num = (r << 24) | (g << 16) | (b << 8) | a;
-	OSScreenClearBufferEx(activeScreen, num);
+	u32 num = DRAW_COLOR(r, g, b, a);
+	if(recordCmd(CMD_FILL, 0, 0, 0, 0, 0, num, NULL, NULL))
+		return;
+	ClipState *clip = currentClip();
+#ifdef DRAW_BENCH
+	if(drawSlowPath && !clip->rects)
+	{
+		backendClear(activeScreen, num);
+		return;
+	}
+#endif
+	if(clip->rects)
+	{
+		for(int i = 0; i < clip->num; i++)
+		{
+			for(int y = clip->rects[i].y1; y <= clip->rects[i].y2; y++)
+				fillRun(clip->rects[i].x1, clip->rects[i].x2, y, num);
+		}
+		return;
+	}
+	
+	u32 *buf = getDrawBuffer();
+	fillPixels(buf, drawPitch[activeScreen] * getScreenHeight(), num);
 }
 
 //Rendering in 
 void drawPixel(int x, int y, char r, char g, char b, char a)
 {
-	uint32_t num = (r << 24) | (g << 16) | (b << 8) | a;
-	OSScreenPutPixelEx(activeScreen,x,y,num);
+	if(recordCmd(CMD_PIXEL, x, y, x, y, 0, DRAW_COLOR(r, g, b, a), NULL, NULL))
+		return;
+	drawSpan(x, x, y, DRAW_COLOR(r, g, b, a));
 }
 
 void drawLine(int x1, int y1, int x2, int y2, char r, char g, char b, char a)
 {
-
-	int x, y;
+	u32 num = DRAW_COLOR(r, g, b, a);
+	if(recordCmd(CMD_LINE, x1, y1, x2, y2, 0, num, NULL, NULL))
+		return;
+	int y;
 	if (x1 == x2){
-		if (y1 < y2) for (y = y1; y <= y2; y++) drawPixel(x1, y, r, g, b, a);
-		else for (y = y2; y <= y1; y++) drawPixel(x1, y, r, g, b, a);
+		//Vertical lines go a pixel at a time, so skip the ones that miss
+		//everything being repainted up front
+		if (!rectVisible(x1, y1 < y2 ? y1 : y2, x1, y1 < y2 ? y2 : y1)) return;
+		if (y1 < y2) for (y = y1; y <= y2; y++) drawSpan(x1, x1, y, num);
+		else for (y = y2; y <= y1; y++) drawSpan(x1, x1, y, num);
 	}
 	else {
-		if (x1 < x2) for (x = x1; x <= x2; x++) drawPixel(x, y1, r, g, b, a);
-		else for (x = x2; x <= x1; x++) drawPixel(x, y1, r, g, b, a);
+		drawSpan(x1, x2, y1, num);
 	}
 }
 
@@ -109,6 +430,8 @@ void drawBorder(int thickness, char r, char g, char b, char a)
 
 void drawRectThickness(int x1, int y1, int x2, int y2, int thickness, char r, char g, char b, char a)
 {
+	if(recordCmd(CMD_RECT_THICK, x1, y1, x2, y2, thickness, DRAW_COLOR(r, g, b, a), NULL, NULL))
+		return;
 	for(int i = 0; i < thickness; i++)
     {
         drawRect(x1+i,y1+i,x2-i,y2-i, r, g, b, a);
@@ -117,6 +440,8 @@ void drawRectThickness(int x1, int y1, int x2, int y2, int thickness, char r, ch
 
 void drawRect(int x1, int y1, int x2, int y2, char r, char g, char b, char a)
 {
+	if(recordCmd(CMD_RECT, x1, y1, x2, y2, 0, DRAW_COLOR(r, g, b, a), NULL, NULL))
+		return;
 	drawLine(x1, y1, x2, y1, r, g, b, a);
 	drawLine(x2, y1, x2, y2, r, g, b, a);
 	drawLine(x1, y2, x2, y2, r, g, b, a);
@@ -125,34 +450,21 @@ void drawRect(int x1, int y1, int x2, int y2, char r, char g, char b, char a)
 
 void drawFillRect(int x1, int y1, int x2, int y2, char r, char g, char b, char a)
 {
-	int X1, X2, Y1, Y2, i, j;
-
-	if (x1 < x2){
-		X1 = x1;
-		X2 = x2;
-	}
-	else {
-		X1 = x2;
-		X2 = x1;
-	}
+	u32 num = DRAW_COLOR(r, g, b, a);
+	if(recordCmd(CMD_FILL_RECT, x1, y1, x2, y2, 0, num, NULL, NULL))
+		return;
+	int Y1 = y1 < y2 ? y1 : y2;
+	int Y2 = y1 < y2 ? y2 : y1;
 
-	if (y1 < y2){
-		Y1 = y1;
-		Y2 = y2;
-	}
-	else {
-		Y1 = y2;
-		Y2 = y1;
-	}
-	for (i = X1; i <= X2; i++){
-		for (j = Y1; j <= Y2; j++){
-			drawPixel(i, j, r, g, b, a);
-		}
+	for (int j = Y1; j <= Y2; j++){
+		drawSpan(x1, x2, j, num);
 	}
 }
 
 void drawCircle(int xCen, int yCen, int radius, char r, char g, char b, char a)
 {
+	if(recordCmd(CMD_CIRCLE, xCen, yCen, 0, 0, radius, DRAW_COLOR(r, g, b, a), NULL, NULL))
+		return;
 	int x = 0;
 	int y = radius;
 	int p = (5 - radius * 4) / 4;
@@ -172,17 +484,28 @@ void drawCircle(int xCen, int yCen, int radius, char r, char g, char b, char a)
 
 void drawFillCircle(int xCen, int yCen, int radius, char r, char g, char b, char a)
 {
+	if(recordCmd(CMD_FILL_CIRCLE, xCen, yCen, 0, 0, radius, DRAW_COLOR(r, g, b, a), NULL, NULL))
+		return;
 	drawCircle(xCen, yCen, radius, r, g, b, a);
-	int x, y;
-	for (y = -radius; y <= radius; y++){
-		for (x = -radius; x <= radius; x++)
-			if (x*x + y*y <= radius*radius + radius * .8f)
-				drawPixel(xCen + x, yCen + y, r, g, b, a);
+	u32 num = DRAW_COLOR(r, g, b, a);
+	float limit = radius*radius + radius * .8f;
+	int x = radius, y;
+	for (y = 0; y <= radius; y++){
+		//Each row is one span, and it only gets narrower moving away from the center
+		while (x >= 0 && x*x + y*y > limit)
+			x--;
+		if (x < 0)
+			break;
+		drawSpan(xCen - x, xCen + x, yCen + y, num);
+		if (y)
+			drawSpan(xCen - x, xCen + x, yCen - y, num);
 	}
 }
 
 void drawCircleCircum(int cx, int cy, int x, int y, char r, char g, char b, char a)
 {
+	if(recordCmd(CMD_CIRCUM, cx, cy, x, y, 0, DRAW_COLOR(r, g, b, a), NULL, NULL))
+		return;
 
 	if (x == 0){
 		drawPixel(cx, cy + y, r, g, b, a);
@@ -211,47 +534,348 @@ void drawCircleCircum(int cx, int cy, int x, int y, char r, char g, char b, char
 extern const u8 msx_font[];
 int multiplier = 2;
 
+//Each glyph row expanded to the current multiplier, leftmost pixel in the top
+//bit. Text gets drawn over other things, so these stay masks and the color is
+//applied as runs of set bits are filled.
+static u32 glyphRows[256][8];
+static int glyphScale = 0;
+
+#define GLYPH_BATCH 128
+
+static void buildGlyphCache()
+{
+    for(int c = 0; c < 256; c++)
+    {
+        for(int i = 0; i < 8; i++)
+        {
+            u8 bits = msx_font[c * 8 + i];
+            u32 mask = 0;
+            for(int j = 0; j < 8; j++)
+            {
+                if(bits & (128 >> j))
+                    mask |= (0xFFFFFFFF << (32 - multiplier)) >> (j * multiplier);
+            }
+            glyphRows[c][i] = mask;
+        }
+    }
+    glyphScale = multiplier;
+}
+
+//Draws a run of glyphs one framebuffer row at a time, so each row of the
+//string is written left to right instead of glyph by glyph
+static void blitGlyphs(int x, int y, const u8 *chars, const u32 *colors, int count)
+{
+    int width = getScreenWidth();
+    int height = getScreenHeight();
+    int advance = 8 * multiplier;
+    bool clipped = currentClip()->rects != NULL;
+    
+    if(!rectVisible(x, y + multiplier, x + count*advance - 1, y + 9*multiplier - 1))
+        return;
+    
+    if(glyphScale != multiplier)
+        buildGlyphCache();
+    
+    for(int i = 0; i < 8; i++)
+    {
+        for(int sub = 0; sub < multiplier; sub++)
+        {
+            int py = y + (i+1)*multiplier + sub;
+            if(py < 0 || py >= height)
+                continue;
+            
+            u32 *row = getDrawBuffer() + py*drawPitch[activeScreen];
+            for(int n = 0; n < count; n++)
+            {
+                u32 mask = glyphRows[chars[n]][i];
+                int gx = x + n*advance;
+                while(mask)
+                {
+                    int start = __builtin_clz(mask);
+                    u32 rest = ~(mask << start);
+                    int len = rest ? __builtin_clz(rest) : 32;
+                    mask = start + len >= 32 ? 0 : mask & (0xFFFFFFFF >> (start + len));
+                    
+                    int x1 = gx + start;
+                    int x2 = x1 + len - 1;
+#ifdef DRAW_BENCH
+                    if(drawSlowPath)
+                    {
+                        drawSpan(x1, x2, py, colors[n]);
+                        continue;
+                    }
+#endif
+                    if(clipped)
+                    {
+                        drawSpan(x1, x2, py, colors[n]);
+                        continue;
+                    }
+                    if(x1 < 0)
+                        x1 = 0;
+                    if(x2 >= width)
+                        x2 = width - 1;
+                    if(x1 <= x2)
+                        fillPixels(row + x1, x2 - x1 + 1, colors[n]);
+                }
+            }
+        }
+    }
+}
+
 void drawCharacter(char c, int x, int y, int r, int g, int b, int a)
 {
-    u8 *font = (u8*)(msx_font + c * 8);
-    int i, j;
-    for (i = 7; i >= 0; --i)
+    u8 ch = c;
+    u32 color = DRAW_COLOR(r, g, b, a);
+    blitGlyphs(x, y, &ch, &color, 1);
+}
+
+//Strings that were drawn before, kept as the runs of pixels they rasterize
+//to. Keyed by the string and its base color, \x80 color changes included, so
+//redrawing one is only filling spans. Everything lives in fixed pools that
+//are emptied at once when one of them runs out.
+#define TEXT_CACHE_SIZE 256
+#define TEXT_CACHE_CHARS 0x8000
+#define TEXT_CACHE_SPANS 0x8000
+#define TEXT_COLORS 8
+
+typedef struct TextSpan
+{
+    u16 x;
+    u16 len;
+    u16 row;
+    u16 color;
+} TextSpan;
+
+typedef struct TextLayout
+{
+    bool used;
+    u32 hash;
+    u32 color;
+    u32 text;
+    u32 textLen;
+    u32 spans;
+    u32 numSpans;
+    int width;
+    int rows;
+    u32 colors[TEXT_COLORS];
+} TextLayout;
+
+static TextLayout textCache[TEXT_CACHE_SIZE];
+static int textCacheUsed = 0;
+static char textCacheChars[TEXT_CACHE_CHARS];
+static u32 textCacheCharsUsed = 0;
+static TextSpan textCacheSpans[TEXT_CACHE_SPANS];
+static u32 textCacheSpansUsed = 0;
+static int textCacheScale = 0;
+static u32 textCacheFlushes = 0;
+
+static void flushTextCache()
+{
+    textCacheFlushes++;
+    memset(textCache, 0, sizeof(textCache));
+    textCacheUsed = 0;
+    textCacheCharsUsed = 0;
+    textCacheSpansUsed = 0;
+    textCacheScale = multiplier;
+}
+
+static TextLayout *buildTextLayout(const u8 *str, u32 textLen, u32 hash, u32 color)
+{
+    u8 chars[TEXT_MAX];
+    u8 inks[TEXT_MAX];
+    int count = 0;
+    TextLayout layout;
+    
+    if(textLen > TEXT_MAX)
+        return NULL;
+    
+    memset(&layout, 0, sizeof(layout));
+    layout.colors[0] = color;
+    int numColors = 1, ink = 0;
+    
+    //Decode the escapes first, a newline is kept as a glyph with no ink
+    for(const u8 *s = str; *s; s++)
+    {
+        if(*s == 0x80)
+        {
+            if(!s[1] || !s[2] || !s[3])
+                break;
+            u32 c = DRAW_COLOR(s[1], s[2], s[3], color);
+            for(ink = 0; ink < numColors && layout.colors[ink] != c; ink++);
+            if(ink == TEXT_COLORS)
+                return NULL;
+            if(ink == numColors)
+                layout.colors[numColors++] = c;
+            s += 3;
+        }
+        else if(*s >= 32 || *s == '\n')
+        {
+            chars[count] = *s;
+            inks[count++] = *s == '\n' ? 0xFF : ink;
+        }
+    }
+    
+    if(textCacheScale != multiplier || textCacheUsed >= TEXT_CACHE_SIZE/2
+       || textCacheCharsUsed + textLen > TEXT_CACHE_CHARS
+       || textCacheSpansUsed + count*32 > TEXT_CACHE_SPANS)
+        flushTextCache();
+    if(count*32 > TEXT_CACHE_SPANS)
+        return NULL;
+    
+    if(glyphScale != multiplier)
+        buildGlyphCache();
+    
+    //Spans go out a glyph row at a time, with touching runs of the same color
+    //merged even across glyphs
+    int advance = 8 * multiplier;
+    TextSpan *spans = &textCacheSpans[textCacheSpansUsed];
+    int numSpans = 0, line = 0;
+    for(int first = 0; first <= count; line++)
+    {
+        int last = first;
+        while(last < count && inks[last] != 0xFF)
+            last++;
+        if((last - first)*advance > layout.width)
+            layout.width = (last - first)*advance;
+        
+        for(int i = 0; i < 8; i++)
+        {
+            int row = line*8 + i;
+            for(int n = first; n < last; n++)
+            {
+                u32 mask = glyphRows[chars[n]][i];
+                int gx = (n - first)*advance;
+                while(mask)
+                {
+                    int start = __builtin_clz(mask);
+                    u32 rest = ~(mask << start);
+                    int len = rest ? __builtin_clz(rest) : 32;
+                    mask = start + len >= 32 ? 0 : mask & (0xFFFFFFFF >> (start + len));
+                    
+                    TextSpan *prev = numSpans ? &spans[numSpans-1] : NULL;
+                    if(prev && prev->row == row && prev->color == inks[n] && prev->x + prev->len == gx + start)
+                    {
+                        prev->len += len;
+                        continue;
+                    }
+                    spans[numSpans].x = gx + start;
+                    spans[numSpans].len = len;
+                    spans[numSpans].row = row;
+                    spans[numSpans++].color = inks[n];
+                }
+            }
+        }
+        first = last + 1;
+    }
+    
+    layout.used = true;
+    layout.hash = hash;
+    layout.color = color;
+    layout.text = textCacheCharsUsed;
+    layout.textLen = textLen;
+    layout.spans = textCacheSpansUsed;
+    layout.numSpans = numSpans;
+    layout.rows = line*8;
+    memcpy(textCacheChars + textCacheCharsUsed, str, textLen);
+    textCacheCharsUsed += textLen;
+    textCacheSpansUsed += numSpans;
+    
+    u32 slot = hash % TEXT_CACHE_SIZE;
+    while(textCache[slot].used)
+        slot = (slot + 1) % TEXT_CACHE_SIZE;
+    textCache[slot] = layout;
+    textCacheUsed++;
+    return &textCache[slot];
+}
+
+static TextLayout *findTextLayout(const char *str, u32 color)
+{
+    u32 textLen = strlen(str) + 1;
+    u32 hash = hashBytes(hashBytes(2166136261u, &color, sizeof(color)), str, textLen);
+    
+    if(textCacheScale == multiplier)
+    {
+        for(u32 slot = hash % TEXT_CACHE_SIZE; textCache[slot].used; slot = (slot + 1) % TEXT_CACHE_SIZE)
+        {
+            TextLayout *layout = &textCache[slot];
+            if(layout->hash == hash && layout->color == color && layout->textLen == textLen
+               && !memcmp(textCacheChars + layout->text, str, textLen))
+                return layout;
+        }
+    }
+    return buildTextLayout((const u8*)str, textLen, hash, color);
+}
+
+static void drawTextLayout(int x, int y, const TextLayout *layout)
+{
+    int width = getScreenWidth();
+    int height = getScreenHeight();
+    bool clipped = currentClip()->rects != NULL;
+    
+    if(!layout->width || !rectVisible(x, y + multiplier, x + layout->width - 1, y + (layout->rows+1)*multiplier - 1))
+        return;
+    
+    const TextSpan *spans = &textCacheSpans[layout->spans];
+    for(u32 first = 0, last; first < layout->numSpans; first = last)
     {
-        for (j = 0; j < 8; ++j)
+        int row = spans[first].row;
+        for(last = first; last < layout->numSpans && spans[last].row == row; last++);
+        
+        for(int sub = 0; sub < multiplier; sub++)
         {
-            if ((*font & (128 >> j)))
+            int py = y + (row+1)*multiplier + sub;
+            if(py < 0 || py >= height)
+                continue;
+            
+            u32 *line = getDrawBuffer() + py*drawPitch[activeScreen];
+            for(u32 n = first; n < last; n++)
             {
-                drawFillRect(x+(j*multiplier), y+((8-i)*multiplier), x+(j*multiplier)+(multiplier-1), y+((8-i)*multiplier)+(multiplier-1), r, g, b, a);
+                int x1 = x + spans[n].x;
+                int x2 = x1 + spans[n].len - 1;
+                u32 color = layout->colors[spans[n].color];
+#ifdef DRAW_BENCH
+                if(drawSlowPath)
+                {
+                    drawSpan(x1, x2, py, color);
+                    continue;
+                }
+#endif
+                if(clipped)
+                {
+                    drawSpan(x1, x2, py, color);
+                    continue;
+                }
+                if(x1 < 0)
+                    x1 = 0;
+                if(x2 >= width)
+                    x2 = width - 1;
+                if(x1 <= x2)
+                    fillPixels(line + x1, x2 - x1 + 1, color);
             }
         }
-        ++font;
     }
 }
 
 void centerStringfColor(int y, int r, int g, int b, int a, char *format, ...)
 {
-    char *buffer = malloc(0x500);
+    char buffer[TEXT_MAX];
     va_list args;
     va_start(args, format);
-    vsnprintf(buffer, 0x500, format, args);
+    vsnprintf(buffer, TEXT_MAX, format, args);
     va_end(args);
 
     centerStringColor(y,buffer,r,g,b,a);
-    free(buffer);
 }
 
 void centerStringf(int y, char *format, ...)
 {
-    char *buffer = malloc(0x500);
-    char *buffer_format = malloc(0x500);
-    strcpy(buffer_format, format);
+    char buffer[TEXT_MAX];
     va_list args;
-    va_start(args, buffer_format);
-    vsnprintf(buffer, 0x500, buffer_format, args);
+    va_start(args, format);
+    vsnprintf(buffer, TEXT_MAX, format, args);
     va_end(args);
 
     centerStringColor(y,buffer,255,255,255,0);
-    free(buffer);
 }
 
 void centerString(int y, char *str)
@@ -259,9 +883,15 @@ void centerString(int y, char *str)
     centerStringColor(y,str,255,255,255,0);
 }
 
+//How wide centering takes a string to be, color codes included
+int getStringWidth(const char *str)
+{
+    return strlen(str)*8*multiplier;
+}
+
 void centerStringColor(int y, char *str, int r, int g, int b, int a)
 {
-    drawStringColor(getScreenWidth()/2 - (strlen(str)*8*multiplier/2),y,str,r,g,b,a);
+    drawStringColor(getScreenWidth()/2 - getStringWidth(str)/2,y,str,r,g,b,a);
 }
 
 void drawString(int x, int y, char* str)
@@ -271,64 +901,1032 @@ void drawString(int x, int y, char* str)
 
 void drawStringf(int x, int y, const char *format, ...)
 {
-    char *buffer = malloc(0x500);
+    char buffer[TEXT_MAX];
     va_list args;
     va_start(args, format);
-    vsnprintf(buffer, 0x500, format, args);
+    vsnprintf(buffer, TEXT_MAX, format, args);
     va_end(args);
     
 	drawString(x,y,buffer);
-	free(buffer);
 }
 
 void drawStringfColor(int x, int y, int r, int g, int b, int a, const char *format, ...)
 {
-    char *buffer = malloc(0x500);
+    char buffer[TEXT_MAX];
     va_list args;
     va_start(args, format);
-    vsnprintf(buffer, 0x500, format, args);
+    vsnprintf(buffer, TEXT_MAX, format, args);
     va_end(args);
     
 	drawStringColor(x,y,buffer,r,g,b,a);
-	free(buffer);
+}
+
+//For strings too long or too colorful to cache. Collects glyphs until a line
+//ends or the batch fills, then blits them together.
+static void drawGlyphRuns(int x, int y, const char *str, u32 color)
+{
+    const u8 *s = (const u8*)str;
+    u8 chars[GLYPH_BATCH];
+    u32 colors[GLYPH_BATCH];
+    u8 a = color;
+    int count = 0;
+    int dx=0, dy=0;
+    
+    for(;;)
+    {
+        if(*s == 0x80)
+        {
+            if(!s[1] || !s[2] || !s[3])
+            {
+                s += strlen((const char*)s);
+                continue;
+            }
+            color = DRAW_COLOR(s[1], s[2], s[3], a);
+            s += 4;
+            continue;
+        }
+        
+        if(*s >= 32)
+        {
+            chars[count] = *s;
+            colors[count++] = color;
+            if(count < GLYPH_BATCH)
+            {
+                s++;
+                continue;
+            }
+        }
+        
+        if(count)
+        {
+            blitGlyphs(x+(dx*multiplier), y+(dy*multiplier), chars, colors, count);
+            dx += count*8;
+            count = 0;
+        }
+        
+        if(!*s)
+            break;
+        if(*s=='\n'){dx=0;dy+=8;}
+        s++;
+    }
 }
 
 void drawStringColor(int x, int y, char* str, int r, int g, int b, int a)
 {
     if(!str)return;
-    int k;
-    int dx=0, dy=0;
-    for(k=0;k<strlen(str);k++)
+    if(recordCmd(CMD_TEXT, x, y, 0, 0, 0, DRAW_COLOR(r, g, b, a), NULL, str))
+        return;
+    u32 color = DRAW_COLOR(r, g, b, a);
+    TextLayout *layout = findTextLayout(str, color);
+    if(layout)
+        drawTextLayout(x, y, layout);
+    else
+        drawGlyphRuns(x, y, str, color);
+}
+
+
+bool loadTGASurface(Surface *surface, void *tga_mem, size_t len)
+{
+    u8 *tga = tga_mem;
+    if(len < sizeof(tga_hdr))
+        return false;
+    
+    //Header fields are little endian, and only uncompressed 32-bit images are used
+    int width = tga[12] | (tga[13] << 8);
+    int height = tga[14] | (tga[15] << 8);
+    size_t offset = sizeof(tga_hdr) + tga[0];
+    if(tga[2] != 2 || tga[16] != 32 || !width || !height || offset + (size_t)width*height*4 > len)
+        return false;
+    
+    if(!surface->pixels || surface->width*surface->height < width*height)
+    {
+        u32 *pixels = realloc(surface->pixels, width*height*4);
+        if(!pixels)
+            return false;
+        surface->pixels = pixels;
+    }
+    
+    //Rows are stored bottom up unless the descriptor says otherwise
+    bool topDown = tga[17] & 0x20;
+    for(int y = 0; y < height; y++)
     {
-        if(str[k] == 0x80)
+        u8 *src = tga + offset + (topDown ? y : height-1-y)*width*4;
+        u32 *dst = surface->pixels + y*width;
+        for(int x = 0; x < width; x++, src += 4)
+            dst[x] = DRAW_COLOR(src[2], src[1], src[0], src[3]);
+    }
+    
+    surface->width = width;
+    surface->height = height;
+    surface->generation++;
+    return true;
+}
+
+void freeSurface(Surface *surface)
+{
+    free(surface->pixels);
+    surface->pixels = NULL;
+    surface->width = 0;
+    surface->height = 0;
+}
+
+bool copySurface(Surface *dst, const Surface *src)
+{
+    int size = src->width*src->height;
+    if(!dst->pixels || dst->width*dst->height < size)
+    {
+        u32 *pixels = realloc(dst->pixels, size*4);
+        if(!pixels)
+            return false;
+        dst->pixels = pixels;
+    }
+    
+    memcpy(dst->pixels, src->pixels, size*4);
+    dst->width = src->width;
+    dst->height = src->height;
+    dst->generation++;
+    return true;
+}
+
+//Blends src over dst by src alpha, leaving dst alpha alone. Two channels are
+//done per multiply, 0x00RR00BB and 0x00GG00AA, with alpha scaled to 0..256 so
+//both ends come out exact and nothing carries into the next channel.
+static inline u32 blendPixel(u32 d, u32 s)
+{
+    u32 a = s & 0xFF;
+    if(a == 0xFF)
+        return (s & 0xFFFFFF00) | (d & 0xFF);
+    if(!a)
+        return d;
+    
+    a += a >> 7;
+    u32 rb = ((((s >> 8) & 0x00FF00FF) * a + ((d >> 8) & 0x00FF00FF) * (256 - a)) >> 8) & 0x00FF00FF;
+    u32 ga = (((s & 0x00FF00FF) * a + (d & 0x00FF00FF) * (256 - a)) >> 8) & 0x00FF00FF;
+    return (rb << 8) | (ga & 0x00FF0000) | (d & 0xFF);
+}
+
+static void blendPixels(u32 *dst, const u32 *src, int len)
+{
+#ifdef __SSE2__
+    //Same math four pixels at a time, each channel widened to 16 bits
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(256);
+    const __m128i keep = _mm_set1_epi32(0xFF);
+    for(; len >= 4; len -= 4, src += 4, dst += 4)
+    {
+        __m128i s = _mm_loadu_si128((const __m128i*)src);
+        __m128i d = _mm_loadu_si128((const __m128i*)dst);
+        __m128i out[2];
+        
+        for(int half = 0; half < 2; half++)
+        {
+            __m128i s16 = half ? _mm_unpackhi_epi8(s, zero) : _mm_unpacklo_epi8(s, zero);
+            __m128i d16 = half ? _mm_unpackhi_epi8(d, zero) : _mm_unpacklo_epi8(d, zero);
+            __m128i a = _mm_shufflelo_epi16(_mm_shufflehi_epi16(s16, 0), 0);
+            a = _mm_add_epi16(a, _mm_srli_epi16(a, 7));
+            out[half] = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(s16, a), _mm_mullo_epi16(d16, _mm_sub_epi16(full, a))), 8);
+        }
+        
+        __m128i res = _mm_packus_epi16(out[0], out[1]);
+        res = _mm_or_si128(_mm_andnot_si128(keep, res), _mm_and_si128(keep, d));
+        _mm_storeu_si128((__m128i*)dst, res);
+    }
+#endif
+    while(len-- > 0)
+    {
+        *dst = blendPixel(*dst, *src++);
+        dst++;
+    }
+}
+
+static inline void copyRun(int x1, int x2, int y, const u32 *src, bool blend)
+{
+#ifdef DRAW_BENCH
+    if(drawSlowPath)
+    {
+        for(int x = x1; x <= x2; x++, src++)
         {
-            r = str[k+1];
-            g = str[k+2];
-            b = str[k+3];
-            k += 3;
+            u32 pixel = *src;
+            if(blend)
+                pixel = blendPixel(getDrawBuffer()[y*drawPitch[activeScreen] + x], pixel);
+            backendPutPixel(activeScreen, x, y, pixel);
+        }
+        return;
+    }
+#endif
+    
+    u32 *buf = getDrawBuffer() + y*drawPitch[activeScreen] + x1;
+    if(blend)
+        blendPixels(buf, src, x2 - x1 + 1);
+    else
+        memcpy(buf, src, (x2 - x1 + 1) * sizeof(u32));
+}
+
+//Copies or blends len pixels to row y starting at x, clipped to the screen and
+//the dirty areas
+static void blitRow(int x, int y, const u32 *src, int len, bool blend)
+{
+    int x1 = x;
+    int x2 = x + len - 1;
+    int width = getScreenWidth();
+    if(y < 0 || y >= (int)getScreenHeight() || x2 < 0 || x1 >= width)
+        return;
+    if(x1 < 0)
+        x1 = 0;
+    if(x2 >= width)
+        x2 = width - 1;
+    
+    ClipState *clip = currentClip();
+    if(!clip->rects)
+    {
+        copyRun(x1, x2, y, src + (x1 - x), blend);
+        return;
+    }
+    
+    for(int i = 0; i < clip->num; i++)
+    {
+        DirtyRect *r = &clip->rects[i];
+        if(y < r->y1 || y > r->y2)
+            continue;
+        
+        int cx1 = x1 > r->x1 ? x1 : r->x1;
+        int cx2 = x2 < r->x2 ? x2 : r->x2;
+        if(cx1 <= cx2)
+            copyRun(cx1, cx2, y, src + (cx1 - x), blend);
+    }
+}
+
+static void blitSurface(int x_pos, int y_pos, Surface *surface, bool blend)
+{
+    if(!surface->pixels)
+        return;
+    if(recordCmd(blend ? CMD_BLEND : CMD_SURFACE, x_pos, y_pos, x_pos + surface->width - 1, y_pos + surface->height - 1, surface->generation, 0, surface, NULL))
+        return;
+    if(!rectVisible(x_pos, y_pos, x_pos + surface->width - 1, y_pos + surface->height - 1))
+        return;
+    
+    for(int y = 0; y < surface->height; y++)
+        blitRow(x_pos, y_pos + y, surface->pixels + y*surface->width, surface->width, blend);
+}
+
+void drawSurface(int x_pos, int y_pos, Surface *surface)
+{
+    blitSurface(x_pos, y_pos, surface, false);
+}
+
+void drawSurfaceBlend(int x_pos, int y_pos, Surface *surface)
+{
+    blitSurface(x_pos, y_pos, surface, true);
+}
+
+#ifdef DRAW_BENCH
+//Blends a 256x256 surface with every alpha value into an offscreen buffer and
+//reports the time against a plain row copy and the one-pixel-at-a-time path
+void drawBenchBlend()
+{
+    int size = 256, rounds = 200;
+    u32 *src = malloc(size*size*4);
+    u32 *dst = malloc(size*size*4);
+    if(!src || !dst)
+    {
+        free(src);
+        free(dst);
+        return;
+    }
+    
+    for(int i = 0; i < size*size; i++)
+    {
+        src[i] = (i * 2654435761u) & 0xFFFFFF00;
+        src[i] |= i & 0xFF;
+        dst[i] = i * 40503u;
+    }
+    
+    OSTime start = OSGetSystemTime();
+    for(int r = 0; r < rounds; r++)
+        memcpy(dst, src, size*size*4);
+    OSTime copyTime = OSGetSystemTime() - start;
+    
+    start = OSGetSystemTime();
+    for(int r = 0; r < rounds; r++)
+    {
+        for(int i = 0; i < size*size; i++)
+            dst[i] = blendPixel(dst[i], src[i]);
+    }
+    OSTime scalarTime = OSGetSystemTime() - start;
+    
+    start = OSGetSystemTime();
+    for(int r = 0; r < rounds; r++)
+    {
+        for(int y = 0; y < size; y++)
+            blendPixels(dst + y*size, src + y*size, size);
+    }
+    OSTime blendTime = OSGetSystemTime() - start;
+    
+    u64 pixels = (u64)size*size*rounds;
+    OSReport("blend bench: copy %llu, per pixel %llu, rows %llu ns/kpixel\n",
+             (unsigned long long)(OSTicksToMicroseconds(copyTime) * 1000000 / pixels),
+             (unsigned long long)(OSTicksToMicroseconds(scalarTime) * 1000000 / pixels),
+             (unsigned long long)(OSTicksToMicroseconds(blendTime) * 1000000 / pixels));
+    free(src);
+    free(dst);
+}
+#endif
+
+static u32 hashBytes(u32 hash, const void *data, u32 len)
+{
+    const u8 *p = data;
+    while(len--)
+        hash = (hash ^ *p++) * 16777619;
+    return hash;
+}
+
+static void textBounds(DrawCmd *cmd, const u8 *s)
+{
+    int cols = 0, maxCols = 0, lines = 1;
+    for(; *s; s++)
+    {
+        if(*s == 0x80)
+        {
+            if(!s[1] || !s[2] || !s[3])
+                break;
+            s += 3;
+        }
+        else if(*s >= 32)
+        {
+            if(++cols > maxCols)
+                maxCols = cols;
+        }
+        else if(*s == '\n')
+        {
+            cols = 0;
+            lines++;
+        }
+    }
+    
+    cmd->bounds.x1 = cmd->x1;
+    cmd->bounds.y1 = cmd->y1 + multiplier;
+    cmd->bounds.x2 = cmd->x1 + maxCols*8*multiplier - 1;
+    cmd->bounds.y2 = cmd->y1 + ((lines-1)*8 + 9)*multiplier - 1;
+}
+
+static void cmdBounds(DrawCmd *cmd)
+{
+    DirtyRect *b = &cmd->bounds;
+    int m;
+    
+    switch(cmd->type)
+    {
+        case CMD_FILL:
+            b->x1 = 0;
+            b->y1 = 0;
+            b->x2 = getScreenWidth() - 1;
+            b->y2 = getScreenHeight() - 1;
+            return;
+        case CMD_LINE:
+            if(cmd->x1 != cmd->x2)
+            {
+                b->x1 = cmd->x1 < cmd->x2 ? cmd->x1 : cmd->x2;
+                b->x2 = cmd->x1 < cmd->x2 ? cmd->x2 : cmd->x1;
+                b->y1 = b->y2 = cmd->y1;
+                return;
+            }
+            //fall through
+        case CMD_PIXEL:
+        case CMD_RECT:
+        case CMD_RECT_THICK:
+        case CMD_FILL_RECT:
+        case CMD_SURFACE:
+        case CMD_BLEND:
+            b->x1 = cmd->x1 < cmd->x2 ? cmd->x1 : cmd->x2;
+            b->x2 = cmd->x1 < cmd->x2 ? cmd->x2 : cmd->x1;
+            b->y1 = cmd->y1 < cmd->y2 ? cmd->y1 : cmd->y2;
+            b->y2 = cmd->y1 < cmd->y2 ? cmd->y2 : cmd->y1;
+            return;
+        case CMD_CIRCLE:
+        case CMD_FILL_CIRCLE:
+        case CMD_CIRCUM:
+            if(cmd->type == CMD_CIRCUM)
+            {
+                m = abs(cmd->x2) > abs(cmd->y2) ? abs(cmd->x2) : abs(cmd->y2);
+            }
+            else
+            {
+                m = abs(cmd->arg);
+            }
+            b->x1 = cmd->x1 - m;
+            b->x2 = cmd->x1 + m;
+            b->y1 = cmd->y1 - m;
+            b->y2 = cmd->y1 + m;
+            return;
+    }
+}
+
+static u32 cmdHash(const DrawCmd *cmd, const char *text)
+{
+    u32 hash = hashBytes(2166136261u, &cmd->type, sizeof(int) * 6);
+    hash = hashBytes(hash, &cmd->color, sizeof(cmd->color));
+    hash = hashBytes(hash, &cmd->data, sizeof(cmd->data));
+    if(text)
+        hash = hashBytes(hash, text, cmd->textLen);
+    return hash;
+}
+
+static bool recordCmd(int type, int x1, int y1, int x2, int y2, int arg, u32 color, void *data, const char *text)
+{
+    if(!recording)
+        return false;
+    if(recordFailed)
+        return true;
+    
+    DisplayList *list = &displayLists[activeScreen][displayCurrent[activeScreen]];
+    u32 textLen = text ? strlen(text) + 1 : 0;
+    
+    if(list->numCmds == list->maxCmds)
+    {
+        int maxCmds = list->maxCmds ? list->maxCmds * 2 : 64;
+        DrawCmd *cmds = realloc(list->cmds, maxCmds * sizeof(DrawCmd));
+        if(!cmds)
+        {
+            recordFailed = true;
+            return true;
+        }
+        list->cmds = cmds;
+        list->maxCmds = maxCmds;
+    }
+    
+    if(list->textLen + textLen > list->textMax)
+    {
+        u32 textMax = list->textMax ? list->textMax : 0x1000;
+        while(list->textLen + textLen > textMax)
+            textMax *= 2;
+        char *buf = realloc(list->text, textMax);
+        if(!buf)
+        {
+            recordFailed = true;
+            return true;
+        }
+        list->text = buf;
+        list->textMax = textMax;
+    }
+    
+    DrawCmd *cmd = &list->cmds[list->numCmds++];
+    cmd->type = type;
+    cmd->x1 = x1;
+    cmd->y1 = y1;
+    cmd->x2 = x2;
+    cmd->y2 = y2;
+    cmd->arg = arg;
+    cmd->color = color;
+    cmd->data = data;
+    cmd->text = list->textLen;
+    cmd->textLen = textLen;
+    cmd->resolved = false;
+    cmd->layout = NULL;
+    if(text)
+    {
+        memcpy(list->text + list->textLen, text, textLen);
+        list->textLen += textLen;
+    }
+    
+    cmd->hash = cmdHash(cmd, text);
+    if(text)
+    {
+        textBounds(cmd, (const u8*)text);
+    }
+    else
+    {
+        cmdBounds(cmd);
+    }
+    return true;
+}
+
+static bool cmdEqual(DisplayList *la, DrawCmd *a, DisplayList *lb, DrawCmd *b)
+{
+    return a->matchHash == b->hash && a->type == b->type
+        && a->x1 == b->x1 && a->matchY1 == b->y1 && a->x2 == b->x2 && a->matchY2 == b->y2
+        && a->arg == b->arg && a->color == b->color && a->data == b->data
+        && a->textLen == b->textLen
+        && !memcmp(la->text + a->text, lb->text + b->text, a->textLen);
+}
+
+static void markCmd(int screen, DrawCmd *cmd)
+{
+    if(cmd->bounds.x1 <= cmd->bounds.x2 && cmd->bounds.y1 <= cmd->bounds.y2)
+        markDirty(screen, cmd->bounds.x1, cmd->bounds.y1, cmd->bounds.x2, cmd->bounds.y2);
+}
+
+static inline bool rectInside(const DirtyRect *a, const DirtyRect *b)
+{
+    return a->x1 >= b->x1 && a->x2 <= b->x2 && a->y1 >= b->y1 && a->y2 <= b->y2;
+}
+
+static inline bool rectOverlaps(const DirtyRect *a, const DirtyRect *b)
+{
+    return a->x1 <= b->x2 && a->x2 >= b->x1 && a->y1 <= b->y2 && a->y2 >= b->y1;
+}
+
+//Marks where a command that's gone left pixels behind. Whatever of it was in
+//the scroll area got copied along with the rest.
+static void markGone(int screen, DrawCmd *cmd, const DirtyRect *scroll, int dy)
+{
+    DirtyRect *b = &cmd->bounds;
+    if(!scroll || !rectInside(b, scroll))
+        markCmd(screen, cmd);
+    if(!scroll || !rectOverlaps(b, scroll))
+        return;
+    
+    int y1 = (b->y1 > scroll->y1 ? b->y1 : scroll->y1) + dy;
+    int y2 = (b->y2 < scroll->y2 ? b->y2 : scroll->y2) + dy;
+    if(y1 < scroll->y1) y1 = scroll->y1;
+    if(y2 > scroll->y2) y2 = scroll->y2;
+    if(y1 <= y2)
+        markDirty(screen, b->x1 > scroll->x1 ? b->x1 : scroll->x1, y1, b->x2 < scroll->x2 ? b->x2 : scroll->x2, y2);
+}
+
+//Moves a command down by dy, y2 is only a position for some of them
+static void shiftCmd(DrawCmd *cmd, int dy)
+{
+    cmd->y1 += dy;
+    cmd->bounds.y1 += dy;
+    cmd->bounds.y2 += dy;
+    switch(cmd->type)
+    {
+        case CMD_PIXEL:
+        case CMD_LINE:
+        case CMD_RECT:
+        case CMD_RECT_THICK:
+        case CMD_FILL_RECT:
+        case CMD_SURFACE:
+        case CMD_BLEND:
+            cmd->y2 += dy;
+            break;
+    }
+}
+
+#define DIFF_BUCKETS 256
+
+//With a scroll, commands inside the scroll area are compared at where they
+//moved to and anything that left the area can't match at all
+static void diffDisplayLists(int screen, DisplayList *prev, DisplayList *cur, const DirtyRect *scroll, int dy)
+{
+    int heads[DIFF_BUCKETS];
+    memset(heads, 0xFF, sizeof(heads));
+    for(int i = prev->numCmds - 1; i >= 0; i--)
+    {
+        DrawCmd *cmd = &prev->cmds[i];
+        cmd->matched = false;
+        cmd->matchY1 = cmd->y1;
+        cmd->matchY2 = cmd->y2;
+        cmd->matchHash = cmd->hash;
+        if(scroll && rectInside(&cmd->bounds, scroll))
+        {
+            DrawCmd moved = *cmd;
+            shiftCmd(&moved, dy);
+            if(!rectInside(&moved.bounds, scroll))
+                continue;
+            cmd->matchY1 = moved.y1;
+            cmd->matchY2 = moved.y2;
+            cmd->matchHash = cmdHash(&moved, cmd->textLen ? prev->text + cmd->text : NULL);
+        }
+        cmd->next = heads[cmd->matchHash % DIFF_BUCKETS];
+        heads[cmd->matchHash % DIFF_BUCKETS] = i;
+    }
+    
+    //Match commands in order, so anything that moved relative to what it
+    //overlaps still gets repainted. Whatever is left over on either side marks
+    //where the two frames differ.
+    int last = -1;
+    for(int i = 0; i < cur->numCmds; i++)
+    {
+        DrawCmd *cmd = &cur->cmds[i];
+        int j = heads[cmd->hash % DIFF_BUCKETS];
+        while(j != -1 && (j <= last || !cmdEqual(prev, &prev->cmds[j], cur, cmd)))
+            j = prev->cmds[j].next;
+        
+        if(j == -1)
+        {
+            markCmd(screen, cmd);
+            continue;
+        }
+        prev->cmds[j].matched = true;
+        last = j;
+    }
+    
+    for(int i = 0; i < prev->numCmds; i++)
+    {
+        if(!prev->cmds[i].matched)
+            markGone(screen, &prev->cmds[i], scroll, dy);
+    }
+}
+
+static void replayCmd(DisplayList *list, DrawCmd *cmd)
+{
+    u8 r = cmd->color >> 24;
+    u8 g = cmd->color >> 16;
+    u8 b = cmd->color >> 8;
+    u8 a = cmd->color;
+    
+    switch(cmd->type)
+    {
+        case CMD_FILL:
+            fillScreen(r, g, b, a);
+            break;
+        case CMD_PIXEL:
+            drawPixel(cmd->x1, cmd->y1, r, g, b, a);
+            break;
+        case CMD_LINE:
+            drawLine(cmd->x1, cmd->y1, cmd->x2, cmd->y2, r, g, b, a);
+            break;
+        case CMD_RECT:
+            drawRect(cmd->x1, cmd->y1, cmd->x2, cmd->y2, r, g, b, a);
+            break;
+        case CMD_RECT_THICK:
+            drawRectThickness(cmd->x1, cmd->y1, cmd->x2, cmd->y2, cmd->arg, r, g, b, a);
+            break;
+        case CMD_FILL_RECT:
+            drawFillRect(cmd->x1, cmd->y1, cmd->x2, cmd->y2, r, g, b, a);
+            break;
+        case CMD_CIRCLE:
+            drawCircle(cmd->x1, cmd->y1, cmd->arg, r, g, b, a);
+            break;
+        case CMD_FILL_CIRCLE:
+            drawFillCircle(cmd->x1, cmd->y1, cmd->arg, r, g, b, a);
+            break;
+        case CMD_CIRCUM:
+            drawCircleCircum(cmd->x1, cmd->y1, cmd->x2, cmd->y2, r, g, b, a);
+            break;
+        case CMD_TEXT:
+            if(!cmd->resolved)
+                drawStringColor(cmd->x1, cmd->y1, list->text + cmd->text, r, g, b, a);
+            else if(cmd->layout)
+                drawTextLayout(cmd->x1, cmd->y1, cmd->layout);
+            else
+                drawGlyphRuns(cmd->x1, cmd->y1, list->text + cmd->text, cmd->color);
+            break;
+        case CMD_SURFACE:
+            drawSurface(cmd->x1, cmd->y1, cmd->data);
+            break;
+        case CMD_BLEND:
+            drawSurfaceBlend(cmd->x1, cmd->y1, cmd->data);
+            break;
+    }
+}
+
+void beginFrame(int screen)
+{
+    DisplayList *list = &displayLists[screen][displayCurrent[screen]];
+    
+    setActiveScreen(screen);
+    list->numCmds = 0;
+    list->textLen = 0;
+    recording = true;
+    recordFailed = false;
+    scrollSet = false;
+}
+
+//Tells endFrame that everything drawn inside the rectangle this frame moved
+//down by dy pixels since the screen's last frame, or up for negative dy. Rows
+//still in the area are copied over from the frame on screen and only what
+//actually changed gets drawn. Only solid fills may reach into the area from
+//outside, anything else there and the whole frame gets compared as usual.
+void scrollRegion(int x1, int y1, int x2, int y2, int dy)
+{
+    if(!recording)
+        return;
+    
+    scrollRect.x1 = x1 < x2 ? x1 : x2;
+    scrollRect.x2 = x1 < x2 ? x2 : x1;
+    scrollRect.y1 = y1 < y2 ? y1 : y2;
+    scrollRect.y2 = y1 < y2 ? y2 : y1;
+    if(scrollRect.x1 < 0) scrollRect.x1 = 0;
+    if(scrollRect.y1 < 0) scrollRect.y1 = 0;
+    if(scrollRect.x2 >= getScreenWidth()) scrollRect.x2 = getScreenWidth() - 1;
+    if(scrollRect.y2 >= getScreenHeight()) scrollRect.y2 = getScreenHeight() - 1;
+    scrollDy = dy;
+    scrollSet = true;
+}
+
+//Whether a command puts the same pixels into the scroll area wherever the
+//area's contents are: it misses the area, moves along inside it, or fills it
+//with one color or leaves it alone
+static bool scrollCompatible(DrawCmd *cmd, const DirtyRect *r)
+{
+    DirtyRect *b = &cmd->bounds;
+    int t;
+    
+    if(!rectOverlaps(b, r) || rectInside(b, r))
+        return true;
+    
+    switch(cmd->type)
+    {
+        case CMD_FILL:
+            return true;
+        case CMD_FILL_RECT:
+            return rectInside(r, b);
+        case CMD_RECT:
+        case CMD_RECT_THICK:
+            t = cmd->type == CMD_RECT ? 1 : cmd->arg;
+            return r->x1 >= b->x1 + t && r->x2 <= b->x2 - t && r->y1 >= b->y1 + t && r->y2 <= b->y2 - t;
+    }
+    return false;
+}
+
+static bool canScroll(int screen, DisplayList *prev, DisplayList *cur)
+{
+    int frame = drawFrame[screen];
+    if(!scrollSet || !frameShown[screen] || !framePointers[screen][!frame])
+        return false;
+    if(!scrollDy || abs(scrollDy) > scrollRect.y2 - scrollRect.y1)
+        return false;
+    
+    //Only the columns something was drawn in need copying, the rest of the
+    //area is background in both frames
+    int x1 = scrollRect.x2, x2 = scrollRect.x1;
+    for(int list = 0; list < 2; list++)
+    {
+        DisplayList *l = list ? cur : prev;
+        for(int i = 0; i < l->numCmds; i++)
+        {
+            DrawCmd *cmd = &l->cmds[i];
+            if(!scrollCompatible(cmd, &scrollRect))
+                return false;
+            if(!rectInside(&cmd->bounds, &scrollRect))
+                continue;
+            if(cmd->bounds.x1 < x1) x1 = cmd->bounds.x1;
+            if(cmd->bounds.x2 > x2) x2 = cmd->bounds.x2;
+        }
+    }
+    if(x1 > x2)
+        return false;
+    
+    scrollRect.x1 = x1;
+    scrollRect.x2 = x2;
+    return true;
+}
+
+//Takes an area out of a dirty list, keeping the parts of anything overlapping
+//it that lie outside
+static void removeDirty(DirtyRect *rects, int *count, const DirtyRect *cut)
+{
+    DirtyRect old[DIRTY_MAX];
+    int num = *count;
+    memcpy(old, rects, num * sizeof(DirtyRect));
+    
+    *count = 0;
+    for(int i = 0; i < num; i++)
+    {
+        DirtyRect r = old[i], piece;
+        if(!rectOverlaps(&r, cut))
+        {
+            addDirty(rects, count, r);
             continue;
         }
         
-        if(str[k]>=32)
+        if(r.y1 < cut->y1)
+        {
+            piece = r;
+            piece.y2 = cut->y1 - 1;
+            addDirty(rects, count, piece);
+            r.y1 = cut->y1;
+        }
+        if(r.y2 > cut->y2)
+        {
+            piece = r;
+            piece.y1 = cut->y2 + 1;
+            addDirty(rects, count, piece);
+            r.y2 = cut->y2;
+        }
+        if(r.x1 < cut->x1)
         {
-            drawCharacter(str[k],x+(dx*multiplier),y+(dy*multiplier),r,g,b,a);
-            dx+=8;
+            piece = r;
+            piece.x2 = cut->x1 - 1;
+            addDirty(rects, count, piece);
+        }
+        if(r.x2 > cut->x2)
+        {
+            piece = r;
+            piece.x1 = cut->x2 + 1;
+            addDirty(rects, count, piece);
         }
-        if(str[k]=='\n'){dx=0;dy+=8;}
     }
 }
 
-void drawTGA(int x_pos, int y_pos, void *tga_mem)
+//Copies the rows still in the scroll area over from the frame on screen to
+//where they moved to in the frame being drawn
+static void copyScrolledRows(int screen)
 {
-    tga_hdr *tga = (tga_hdr*)tga_mem;
-    int height = ((tga->height & 0xFF) << 8) + ((tga->height & 0xFF00) >> 8);
-    int width = ((tga->width & 0xFF) << 8) + ((tga->width & 0xFF00) >> 8);
-    for(int x = 0; x < 128; x++)
+    int frame = drawFrame[screen];
+    int pitch = drawPitch[screen];
+    u32 *dst = framePointers[screen][frame];
+    u32 *src = framePointers[screen][!frame];
+    int len = (scrollRect.x2 - scrollRect.x1 + 1) * sizeof(u32);
+    
+    for(int y = scrollRect.y1; y <= scrollRect.y2; y++)
     {
-        for(int y = 0; y < 128; y++)
+        int from = y - scrollDy;
+        if(from < scrollRect.y1 || from > scrollRect.y2)
+            continue;
+        memcpy(dst + y*pitch + scrollRect.x1, src + from*pitch + scrollRect.x1, len);
+    }
+}
+
+void setDrawWorkers(int count)
+{
+    int max = backendMaxWorkers();
+    drawWorkers = count < 1 ? 1 : count > max ? max : count;
+}
+
+//Splits the dirty areas into one horizontal band per worker, each clipped to
+//its own slice. Returns how many bands ended up with anything in them.
+static int splitTiles(DirtyRect *rects, int count, int workers)
+{
+    int y1 = rects[0].y1, y2 = rects[0].y2;
+    for(int i = 1; i < count; i++)
+    {
+        if(rects[i].y1 < y1) y1 = rects[i].y1;
+        if(rects[i].y2 > y2) y2 = rects[i].y2;
+    }
+    
+    int bands = 0;
+    for(int w = 0; w < workers; w++)
+    {
+        int top = y1 + (y2 - y1 + 1) * w / workers;
+        int bottom = y1 + (y2 - y1 + 1) * (w + 1) / workers - 1;
+        ClipState *clip = &tileClips[bands];
+        clip->rects = tileRects[bands];
+        clip->num = 0;
+        
+        for(int i = 0; i < count; i++)
         {
-            u8 *icon_pixel = (tga_mem+0x12)+((height-1-y)*width*4)+(x*4);
-            drawPixel(x+x_pos,y+y_pos,icon_pixel[2],icon_pixel[1],icon_pixel[0],icon_pixel[3]);
+            DirtyRect r = rects[i];
+            if(r.y1 < top) r.y1 = top;
+            if(r.y2 > bottom) r.y2 = bottom;
+            if(r.y1 <= r.y2)
+                clip->rects[clip->num++] = r;
         }
+        if(clip->num)
+            bands++;
+    }
+    return bands;
+}
+
+//Whatever the text cache needs done has to happen before the workers start
+static bool resolveText(DisplayList *list, DirtyRect *rects, int count)
+{
+    u32 flushes = textCacheFlushes;
+    ClipState *clip = currentClip();
+    clip->rects = rects;
+    clip->num = count;
+    
+    if(glyphScale != multiplier)
+        buildGlyphCache();
+    
+    for(int i = 0; i < list->numCmds; i++)
+    {
+        DrawCmd *cmd = &list->cmds[i];
+        DirtyRect *b = &cmd->bounds;
+        if(cmd->type != CMD_TEXT || !rectVisible(b->x1, b->y1, b->x2, b->y2))
+            continue;
+        cmd->layout = findTextLayout(list->text + cmd->text, cmd->color);
+        cmd->resolved = true;
+    }
+    
+    clip->rects = NULL;
+    clip->num = 0;
+    
+    //A flush partway through would leave earlier layouts pointing at reused
+    //pool space, so draw this frame on one thread instead
+    if(flushes == textCacheFlushes)
+        return true;
+    for(int i = 0; i < list->numCmds; i++)
+        list->cmds[i].resolved = false;
+    return false;
+}
+
+static DisplayList *tileList;
+
+static void replayList(DisplayList *list)
+{
+    for(int i = 0; i < list->numCmds; i++)
+    {
+        DirtyRect *b = &list->cmds[i].bounds;
+        if(rectVisible(b->x1, b->y1, b->x2, b->y2))
+            replayCmd(list, &list->cmds[i]);
+    }
+}
+
+static void replayTile(int worker)
+{
+    ClipState *clip = &clipStates[worker];
+    int band;
+    while((band = __atomic_fetch_add(&tileNext, 1, __ATOMIC_ACQUIRE)) < __atomic_load_n(&tileCount, __ATOMIC_RELAXED))
+    {
+        *clip = tileClips[band];
+        replayList(tileList);
+        clip->rects = NULL;
+        clip->num = 0;
+        __atomic_fetch_add(&tilesDone, 1, __ATOMIC_RELEASE);
+    }
+}
+
+void endFrame()
+{
+    int screen = activeScreen;
+    DisplayList *cur = &displayLists[screen][displayCurrent[screen]];
+    DisplayList *prev = &displayLists[screen][!displayCurrent[screen]];
+    
+    recording = false;
+    
+    //Half a frame can't be diffed, so what's on screen stays and the next
+    //frame repaints all of it
+    if(recordFailed)
+    {
+        cur->numCmds = 0;
+        cur->textLen = 0;
+        markScreenDirty(screen);
+        return;
+    }
+    
+    getDrawBuffer();
+    int frame = drawFrame[screen];
+    bool scrolled = canScroll(screen, prev, cur);
+    
+    if(scrolled)
+    {
+        //This frame's own catching up inside the area is replaced by the copy,
+        //the other one is left with the whole area to redo. The rows scrolled
+        //in are drawn fresh.
+        removeDirty(dirtyRects[screen][frame], &numDirty[screen][frame], &scrollRect);
+        diffDisplayLists(screen, prev, cur, &scrollRect, scrollDy);
+        addDirty(dirtyRects[screen][!frame], &numDirty[screen][!frame], scrollRect);
+        if(scrollDy < 0)
+            markDirty(screen, scrollRect.x1, scrollRect.y2 + scrollDy + 1, scrollRect.x2, scrollRect.y2);
+        else
+            markDirty(screen, scrollRect.x1, scrollRect.y1, scrollRect.x2, scrollRect.y1 + scrollDy - 1);
+        copyScrolledRows(screen);
+    }
+    else
+    {
+        diffDisplayLists(screen, prev, cur, NULL, 0);
+    }
+    displayCurrent[screen] = !displayCurrent[screen];
+    
+    //Nothing differs from what's already in this frame, so leave it on screen
+    if(!numDirty[screen][frame])
+        return;
+    
+    DirtyRect *rects = dirtyRects[screen][frame];
+    int count = numDirty[screen][frame];
+    int tiles = drawWorkers;
+#ifdef DRAW_BENCH
+    if(drawSlowPath)
+        tiles = 1;
+#endif
+    int area = 0;
+    for(int i = 0; i < count; i++)
+        area += (rects[i].x2 - rects[i].x1 + 1) * (rects[i].y2 - rects[i].y1 + 1);
+    if(tiles > 1 && area >= TILE_MIN_AREA && resolveText(cur, rects, count))
+        tiles = splitTiles(rects, count, tiles);
+    else
+        tiles = 1;
+    
+    if(tiles > 1)
+    {
+        tileList = cur;
+        __atomic_store_n(&tileCount, tiles, __ATOMIC_RELAXED);
+        __atomic_store_n(&tilesDone, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&tileNext, 0, __ATOMIC_RELEASE);
+        backendRunWorkers(replayTile, tiles);
+        
+        //Anything left unclaimed was drawn here, so this only waits on bands
+        //another core is partway through
+        while(__atomic_load_n(&tilesDone, __ATOMIC_ACQUIRE) < tiles)
+            ;
+        __atomic_store_n(&tileNext, TILES_IDLE, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        clipStates[0].rects = rects;
+        clipStates[0].num = count;
+        replayList(cur);
+        clipStates[0].rects = NULL;
+        clipStates[0].num = 0;
+    }
+    
+    //Only the repainted areas were written, so only they need flushing, along
+    //with the scrolled rows
+    if(scrolled)
+    {
+        DirtyRect flushRects[DIRTY_MAX + 1];
+        memcpy(flushRects, rects, count * sizeof(DirtyRect));
+        flushRects[count] = scrollRect;
+        backendFlip(screen, flushRects, count + 1);
+    }
+    else
+    {
+        backendFlip(screen, rects, count);
     }
+    drawBuffer[screen] = NULL;
+    numDirty[screen][frame] = 0;
+    frameShown[screen] = true;
 }
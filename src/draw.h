@@ -1,54 +1,106 @@
-/*
- *  woomïnstaller - Homebrew package installer for Wii U
- *
- *  Copyright (C) 2016          SALT
- *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
- *
- *  This code is licensed under the terms of the GNU LGPL, version 2.1
- *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
- */
-
-#ifndef DRAW_H
-#define DRAW_H
-#include <coreinit/screen.h>
-#include <wut_types.h>
-
-typedef struct tga_hdr tga_hdr;
-struct __attribute__((__packed__)) tga_hdr
-{
-    u8 idlength;
-    u8 colormaptype;
-    u8 datatype;
-    u16 colormaporigin;
-    u16 colormaplength;
-    u8 colormapdepth;
-    u16 x_origin;
-    u16 y_origin;
-    u16 width;
-    u16 height;
-    u8 bpp;
-    u8 imagedescriptor;
-};
-
-void *screenBufferTop;
-void *screenBufferBottom;
-
-#define SCREEN_TOP 0
-#define SCREEN_BOTTOM 1
-
-//Function declarations for my graphics library
-void setActiveScreen(int screen);
-void flipBuffers();
-void fillScreen(char r, char g, char b, char a);
-void drawString(int x, int y, char * string);
-void drawPixel(int x, int y, char r, char g, char b, char a);
-void drawLine(int x1, int y1, int x2, int y2, char r, char g, char b, char a);
-void drawBorder(int thickness, char r, char g, char b, char a);
-void drawRect(int x1, int y1, int x2, int y2, char r, char g, char b, char a);
-void drawRectThickness(int x1, int y1, int x2, int y2, int thickness, char r, char g, char b, char a);
-void drawFillRect(int x1, int y1, int x2, int y2, char r, char g, char b, char a);
-void drawCircle(int xCen, int yCen, int radius, char r, char g, char b, char a);
-void drawFillCircle(int xCen, int yCen, int radius, char r, char g, char b, char a);
-void drawCircleCircum(int cx, int cy, int x, int y, char r, char g, char b, char a);
-void drawTGA(int x, int y, void *tga_mem);
-#endif /* DRAW_H */
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+#ifndef DRAW_H
+#define DRAW_H
+#include <stddef.h>
+
+#ifdef DRAW_HEADLESS
+#include <stdbool.h>
+#include <stdint.h>
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;
+#else
+#include <coreinit/screen.h>
+#include <wut_types.h>
+#endif
+
+typedef struct tga_hdr tga_hdr;
+struct __attribute__((__packed__)) tga_hdr
+{
+    u8 idlength;
+    u8 colormaptype;
+    u8 datatype;
+    u16 colormaporigin;
+    u16 colormaplength;
+    u8 colormapdepth;
+    u16 x_origin;
+    u16 y_origin;
+    u16 width;
+    u16 height;
+    u8 bpp;
+    u8 imagedescriptor;
+};
+
+//An image already converted to screen pixels, so drawing it is a row copy
+typedef struct Surface
+{
+    u32 *pixels;
+    int width;
+    int height;
+    u32 generation;
+} Surface;
+
+extern void *screenBufferTop;
+extern void *screenBufferBottom;
+
+#define SCREEN_TOP 0
+#define SCREEN_BOTTOM 1
+
+//Screen resolutions, for mapping touches and laying out without going through
+//the active screen
+#define TV_WIDTH 1280
+#define TV_HEIGHT 720
+#define DRC_WIDTH 854
+#define DRC_HEIGHT 480
+
+#ifdef DRAW_BENCH
+extern bool drawSlowPath;
+void drawBenchBlend();
+#endif
+
+//Function declarations for my graphics library
+u32 getScreenWidth();
+u32 getScreenHeight();
+void setActiveScreen(int screen);
+void flipBuffers();
+void markDirty(int screen, int x1, int y1, int x2, int y2);
+void markScreenDirty(int screen);
+void beginFrame(int screen);
+void setDrawWorkers(int count);
+void scrollRegion(int x1, int y1, int x2, int y2, int dy);
+void endFrame();
+void fillScreen(char r, char g, char b, char a);
+void drawString(int x, int y, char * string);
+void drawStringf(int x, int y, const char *format, ...);
+void drawStringColor(int x, int y, char* str, int r, int g, int b, int a);
+void drawStringfColor(int x, int y, int r, int g, int b, int a, const char *format, ...);
+int getStringWidth(const char *str);
+void centerString(int y, char *str);
+void centerStringf(int y, char *format, ...);
+void centerStringColor(int y, char *str, int r, int g, int b, int a);
+void centerStringfColor(int y, int r, int g, int b, int a, char *format, ...);
+void drawPixel(int x, int y, char r, char g, char b, char a);
+void drawLine(int x1, int y1, int x2, int y2, char r, char g, char b, char a);
+void drawBorder(int thickness, char r, char g, char b, char a);
+void drawRect(int x1, int y1, int x2, int y2, char r, char g, char b, char a);
+void drawRectThickness(int x1, int y1, int x2, int y2, int thickness, char r, char g, char b, char a);
+void drawFillRect(int x1, int y1, int x2, int y2, char r, char g, char b, char a);
+void drawCircle(int xCen, int yCen, int radius, char r, char g, char b, char a);
+void drawFillCircle(int xCen, int yCen, int radius, char r, char g, char b, char a);
+void drawCircleCircum(int cx, int cy, int x, int y, char r, char g, char b, char a);
+bool loadTGASurface(Surface *surface, void *tga_mem, size_t len);
+void freeSurface(Surface *surface);
+bool copySurface(Surface *dst, const Surface *src);
+void drawSurface(int x, int y, Surface *surface);
+void drawSurfaceBlend(int x, int y, Surface *surface);
+#endif /* DRAW_H */
@@ -0,0 +1,52 @@
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+#ifndef DRAW_BACKEND_H
+#define DRAW_BACKEND_H
+#include "draw.h"
+
+//What draw.c needs from whatever owns the framebuffers. draw_osscreen.c
+//implements it with OSScreen on the console, draw_headless.c with plain
+//memory when built with DRAW_HEADLESS.
+
+typedef struct DirtyRect
+{
+    int x1, y1, x2, y2;
+} DirtyRect;
+
+//Returns the frame to draw into for a screen, its pitch in pixels, and which
+//of the screen's two frames it is
+u32 *backendGetFrame(int screen, int *pitch, int *frame);
+//Shows the frame last returned by backendGetFrame. Only the rects given were
+//written since the last flip, or the whole frame when rects is NULL.
+void backendFlip(int screen, const DirtyRect *rects, int count);
+void backendPutPixel(int screen, int x, int y, u32 color);
+void backendClear(int screen, u32 color);
+void backendPutFont(int screen, int x, int y, const char *str);
+
+//Tile workers for rasterizing one frame on several cores. backendRunWorkers
+//wakes fn(1) to fn(count-1) each on its own core and returns once the caller
+//is done with fn(0). The others may start late, or not until a later call, if
+//their core is busy, so fn has to claim its work rather than be handed it.
+//backendWorkerIndex says which one the calling thread is, so anything drawing
+//outside of it has to be index 0.
+#define DRAW_WORKERS_MAX 8
+
+int backendMaxWorkers();
+void backendRunWorkers(void (*fn)(int worker), int count);
+int backendWorkerIndex();
+
+#ifdef DRAW_HEADLESS
+void headlessInit();
+bool headlessWritePNG(int screen, const char *path);
+u32 headlessChecksum(int screen);
+void headlessSetMaxWorkers(int count);
+#endif
+#endif /* DRAW_BACKEND_H */
@@ -0,0 +1,180 @@
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+#ifdef DRAW_HEADLESS
+
+#include "draw_backend.h"
+#include "miniz.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+//Both screens double buffered in plain memory, laid out like OSScreen's so
+//the renderer sees the same flips and dirty frames it does on the console
+static const int screenWidths[2] = { 1280, 854 };
+static const int screenHeights[2] = { 720, 480 };
+static u32 *frames[2][2];
+static int backFrame[2];
+
+void headlessInit()
+{
+    for(int screen = 0; screen < 2; screen++)
+    {
+        for(int frame = 0; frame < 2; frame++)
+        {
+            free(frames[screen][frame]);
+            frames[screen][frame] = calloc(screenWidths[screen] * screenHeights[screen], sizeof(u32));
+        }
+        backFrame[screen] = 0;
+    }
+}
+
+u32 *backendGetFrame(int screen, int *pitch, int *frame)
+{
+    *pitch = screenWidths[screen];
+    *frame = backFrame[screen];
+    return frames[screen][backFrame[screen]];
+}
+
+void backendFlip(int screen, const DirtyRect *rects, int count)
+{
+    backFrame[screen] = !backFrame[screen];
+}
+
+void backendPutPixel(int screen, int x, int y, u32 color)
+{
+    if(x < 0 || y < 0 || x >= screenWidths[screen] || y >= screenHeights[screen])
+        return;
+    frames[screen][backFrame[screen]][y*screenWidths[screen] + x] = color;
+}
+
+void backendClear(int screen, u32 color)
+{
+    u32 *buf = frames[screen][backFrame[screen]];
+    for(int i = 0; i < screenWidths[screen] * screenHeights[screen]; i++)
+        buf[i] = color;
+}
+
+void backendPutFont(int screen, int x, int y, const char *str)
+{
+}
+
+//Tile workers are plain threads, started the first time they're needed and
+//woken for each frame
+static pthread_t workerThreads[DRAW_WORKERS_MAX];
+static pthread_mutex_t workerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workerWake = PTHREAD_COND_INITIALIZER;
+static void (*workerFn)(int worker);
+static int workerCount = 0;
+static u32 workerGeneration = 0;
+static int workersStarted = 1;
+static __thread int workerIndex = 0;
+static int workerLimit = 0;
+
+static void *workerMain(void *arg)
+{
+    workerIndex = (int)(size_t)arg;
+    u32 seen = 0;
+    
+    pthread_mutex_lock(&workerLock);
+    while(true)
+    {
+        while(workerGeneration == seen || workerIndex >= workerCount)
+        {
+            seen = workerGeneration;
+            pthread_cond_wait(&workerWake, &workerLock);
+        }
+        seen = workerGeneration;
+        pthread_mutex_unlock(&workerLock);
+        
+        workerFn(workerIndex);
+        pthread_mutex_lock(&workerLock);
+    }
+    return NULL;
+}
+
+//Lets a test run the tile path with more workers than the host has cores
+void headlessSetMaxWorkers(int count)
+{
+    workerLimit = count;
+}
+
+int backendMaxWorkers()
+{
+    long cores = workerLimit ? workerLimit : sysconf(_SC_NPROCESSORS_ONLN);
+    return cores < 1 ? 1 : cores > DRAW_WORKERS_MAX ? DRAW_WORKERS_MAX : cores;
+}
+
+void backendRunWorkers(void (*fn)(int worker), int count)
+{
+    pthread_mutex_lock(&workerLock);
+    for(; workersStarted < count; workersStarted++)
+        pthread_create(&workerThreads[workersStarted], NULL, workerMain, (void*)(size_t)workersStarted);
+    
+    workerFn = fn;
+    workerCount = count;
+    workerGeneration++;
+    pthread_cond_broadcast(&workerWake);
+    pthread_mutex_unlock(&workerLock);
+    
+    fn(0);
+}
+
+int backendWorkerIndex()
+{
+    return workerIndex;
+}
+
+//FNV-1a over the frame currently on screen, for comparing two ways of
+//drawing the same thing
+u32 headlessChecksum(int screen)
+{
+    u32 *src = frames[screen][!backFrame[screen]];
+    u32 hash = 2166136261u;
+    for(int i = 0; i < screenWidths[screen] * screenHeights[screen]; i++)
+        hash = (hash ^ src[i]) * 16777619u;
+    return hash;
+}
+
+//Writes the frame currently on screen, the one flipped last
+bool headlessWritePNG(int screen, const char *path)
+{
+    int width = screenWidths[screen];
+    int height = screenHeights[screen];
+    u32 *src = frames[screen][!backFrame[screen]];
+    u8 *rgb = malloc(width * height * 3);
+    if(!rgb)
+        return false;
+    
+    for(int i = 0; i < width * height; i++)
+    {
+        rgb[i*3 + 0] = src[i] >> 24;
+        rgb[i*3 + 1] = src[i] >> 16;
+        rgb[i*3 + 2] = src[i] >> 8;
+    }
+    
+    size_t len = 0;
+    void *png = tdefl_write_image_to_png_file_in_memory(rgb, width, height, 3, &len);
+    free(rgb);
+    if(!png)
+        return false;
+    
+    FILE *f = fopen(path, "wb");
+    bool ok = f && fwrite(png, 1, len, f) == len;
+    if(f)
+        fclose(f);
+    mz_free(png);
+    return ok;
+}
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+#ifndef DRAW_HEADLESS
+
+#include "draw_backend.h"
+
+#include <coreinit/cache.h>
+#include <coreinit/core.h>
+#include <coreinit/screen.h>
+#include <coreinit/semaphore.h>
+#include <coreinit/thread.h>
+
+void *screenBufferTop;
+void *screenBufferBottom;
+
+//The frame handed out last for each screen, which is the one flipped next
+static u32 *drawnFrame[2];
+static int drawnPitch[2];
+
+//OSScreen keeps two frames in each screen buffer and draws into whichever one
+//isn't being scanned out. We write pixels ourselves, so find that frame with a
+//probe pixel.
+u32 *backendGetFrame(int screen, int *pitch, int *frame)
+{
+    u8 *base = screen == SCREEN_BOTTOM ? screenBufferBottom : screenBufferTop;
+    u32 frameSize = OSScreenGetBufferSizeEx(screen) / 2;
+    u32 *frames[2] = { (u32*)base, (u32*)(base + frameSize) };
+    u32 saved[2] = { frames[0][0], frames[1][0] };
+    
+    u32 probe = 0x12345678;
+    while(probe == saved[0] || probe == saved[1])
+        probe += 0x01010101;
+    
+    OSScreenPutPixelEx(screen, 0, 0, probe);
+    int back = frames[1][0] == probe;
+    frames[back][0] = saved[back];
+    
+    //The gamepad frame is wider than 854 pixels, go by the buffer size
+    *pitch = frameSize / 4 / (screen == SCREEN_BOTTOM ? 480 : 720);
+    *frame = back;
+    drawnFrame[screen] = frames[back];
+    drawnPitch[screen] = *pitch;
+    return frames[back];
+}
+
+void backendFlip(int screen, const DirtyRect *rects, int count)
+{
+	if(!rects || !drawnFrame[screen])
+	{
+		//Flush the cache for the whole buffer
+		if(screen == SCREEN_BOTTOM)
+		    DCFlushRange(screenBufferBottom, OSScreenGetBufferSizeEx(1));
+		else
+		    DCFlushRange(screenBufferTop, OSScreenGetBufferSizeEx(0));
+	}
+	else
+	{
+		//Only flush the rows of what was written. Rects that cover most of a
+		//row go out as one range, the gaps between them cost less than a
+		//flush call per row.
+		int pitch = drawnPitch[screen];
+		for(int i = 0; i < count; i++)
+		{
+			const DirtyRect *r = &rects[i];
+			u32 *start = drawnFrame[screen] + r->y1*pitch + r->x1;
+			int len = r->x2 - r->x1 + 1;
+			
+			if(len*2 >= pitch)
+			{
+				DCFlushRange(start, ((r->y2 - r->y1)*pitch + len) * 4);
+				continue;
+			}
+			for(int y = r->y1; y <= r->y2; y++, start += pitch)
+				DCFlushRange(start, len * 4);
+		}
+	}
+	
+	//Flip the buffer
+	OSScreenFlipBuffersEx(screen);
+}
+
+void backendPutPixel(int screen, int x, int y, u32 color)
+{
+    OSScreenPutPixelEx(screen, x, y, color);
+}
+
+void backendClear(int screen, u32 color)
+{
+    OSScreenClearBufferEx(screen, color);
+}
+
+void backendPutFont(int screen, int x, int y, const char *str)
+{
+    OSScreenPutFontEx(screen, x, y, str);
+}
+
+//One tile worker per core. The render thread lives on core 1 and is worker 0,
+//the other two get a thread pinned to their core the first time they're
+//needed, so the core a thread is running on says which worker it is.
+#define OSSCREEN_WORKERS 3
+
+static const int workerOfCore[OSSCREEN_WORKERS] = { 1, 0, 2 };
+static const u8 workerAffinity[OSSCREEN_WORKERS] = { OS_THREAD_ATTRIB_AFFINITY_CPU1, OS_THREAD_ATTRIB_AFFINITY_CPU0, OS_THREAD_ATTRIB_AFFINITY_CPU2 };
+
+static OSThread workerThreads[OSSCREEN_WORKERS];
+static u8 workerStacks[OSSCREEN_WORKERS][0x8000] __attribute__((aligned(16)));
+static OSSemaphore workerStart[OSSCREEN_WORKERS];
+static void (*workerFn)(int worker);
+static bool workersStarted = false;
+
+static int workerMain(int argc, const char **argv)
+{
+    int worker = argc;
+    while(true)
+    {
+        OSWaitSemaphore(&workerStart[worker]);
+        workerFn(worker);
+    }
+    return 0;
+}
+
+int backendMaxWorkers()
+{
+    return OSSCREEN_WORKERS;
+}
+
+void backendRunWorkers(void (*fn)(int worker), int count)
+{
+    if(!workersStarted)
+    {
+        for(int i = 1; i < OSSCREEN_WORKERS; i++)
+        {
+            OSInitSemaphore(&workerStart[i], 0);
+            OSCreateThread(&workerThreads[i], workerMain, i, NULL, workerStacks[i] + sizeof(workerStacks[i]), sizeof(workerStacks[i]), 20, workerAffinity[i]);
+            OSResumeThread(&workerThreads[i]);
+        }
+        workersStarted = true;
+    }
+    
+    workerFn = fn;
+    for(int i = 1; i < count; i++)
+        OSSignalSemaphore(&workerStart[i]);
+    fn(0);
+}
+
+int backendWorkerIndex()
+{
+    return workerOfCore[OSGetCoreId()];
+}
+
+#endif
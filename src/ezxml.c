@@ -39,6 +39,17 @@
 
 #define EZXML_WS   "\t\r\n "  // whitespace
 #define EZXML_ERRL 128        // maximum error string length
+#define EZXML_TXTA 0x08       // txt is in the arena after its length and size
+#define EZXML_TXTLEN(xml) (((xml)->flags & EZXML_TXTA) \
+                          ? ((size_t *)(xml)->txt)[-2] : strlen((xml)->txt))
+#define EZXML_ALIGN(n) (((n) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+
+typedef struct ezxml_arena *ezxml_arena_t;
+struct ezxml_arena {      // block of memory for an arena parsed document
+    ezxml_arena_t prev;   // previously filled block, NULL if first
+    size_t size;          // usable size of this block
+    size_t used;          // bytes handed out from this block
+};
 
 typedef struct ezxml_root *ezxml_root_t;
 struct ezxml_root {       // additional data for the root tag
@@ -53,11 +64,46 @@ struct ezxml_root {       // additional data for the root tag
     char ***attr;         // default attributes
     char ***pi;           // processing instructions
     short standalone;     // non-zero if <?xml standalone="yes"?>
+    ezxml_arena_t arena;  // current arena block, NULL if not arena parsed
+    char **tmp;           // scratch attribute list used when arena parsing
+    int tmax;             // number of entries allocated for tmp
+    ezxml_t last;         // last tag closed
     char err[EZXML_ERRL]; // error string
 };
 
 char *EZXML_NIL[] = { NULL }; // empty, null terminated array of strings
 
+// Word at a time scanning needs to read up to the end of the aligned word that
+// holds the null terminator, which address sanitizers report as an overread.
+#if defined(__SANITIZE_ADDRESS__) && ! defined(EZXML_NOSWAR)
+#define EZXML_NOSWAR
+#endif
+
+#ifndef EZXML_NOSWAR
+#define EZXML_ONES  ((unsigned long)-1 / 0xFF)   // 0x01 in every byte
+#define EZXML_HIGHS (EZXML_ONES * 0x80)          // 0x80 in every byte
+#define EZXML_ZERO(w) (((w) - EZXML_ONES) & ~(w) & EZXML_HIGHS) // has 0 byte
+#endif // EZXML_NOSWAR
+
+// Returns a pointer to the first a, b or null terminator in s. Unless built
+// with EZXML_NOSWAR, tests a whole aligned word per step instead of each byte.
+char *ezxml_scan(char *s, char a, char b)
+{
+#ifndef EZXML_NOSWAR
+    unsigned long w, wa = EZXML_ONES * (unsigned char)a,
+                  wb = EZXML_ONES * (unsigned char)b;
+
+    for (; (size_t)s % sizeof(w); s++) // align to a word
+        if (! *s || *s == a || *s == b) return s;
+    for (; ; s += sizeof(w)) {
+        memcpy(&w, s, sizeof(w));
+        if (EZXML_ZERO(w) | EZXML_ZERO(w ^ wa) | EZXML_ZERO(w ^ wb)) break;
+    }
+#endif // EZXML_NOSWAR
+    while (*s && *s != a && *s != b) s++; // find the byte
+    return s;
+}
+
 // returns the first child tag with the given name or NULL if not found
 ezxml_t ezxml_child(ezxml_t xml, const char *name)
 {
@@ -151,26 +197,66 @@ ezxml_t ezxml_err(ezxml_root_t root, char *s, const char *err, ...)
     return &root->xml;
 }
 
+// returns n bytes from the root's arena, starting a new block if needed
+void *ezxml_arena_alloc(ezxml_root_t root, size_t n)
+{
+    ezxml_arena_t a = root->arena, b;
+    size_t size;
+
+    n = EZXML_ALIGN(n);
+    if (a->used + n > a->size) { // block is full, chain a bigger one
+        size = (a->size * 2 > n) ? a->size * 2 : n;
+        b = malloc(sizeof(struct ezxml_arena) + size);
+        b->prev = a;
+        b->size = size;
+        b->used = 0;
+        root->arena = a = b;
+    }
+    a->used += n;
+    return (char *)(a + 1) + a->used - n;
+}
+
+// Resizes p from n to size bytes. Grows in place if p was the last allocation
+// in the arena, otherwise copies it. The old copy is released with the arena.
+void *ezxml_arena_realloc(ezxml_root_t root, void *p, size_t n, size_t size)
+{
+    ezxml_arena_t a = root->arena;
+
+    if ((char *)p + EZXML_ALIGN(n) == (char *)(a + 1) + a->used &&
+        a->used - EZXML_ALIGN(n) + EZXML_ALIGN(size) <= a->size) {
+        a->used += EZXML_ALIGN(size) - EZXML_ALIGN(n);
+        return p;
+    }
+    return memcpy(ezxml_arena_alloc(root, size), p, n);
+}
+
 // Recursively decodes entity and character references and normalizes new lines
 // ent is a null terminated array of alternating entity names and values. set t
 // to '&' for general entity decoding, '%' for parameter entity decoding, 'c'
 // for cdata sections, ' ' for attribute normalization, or '*' for non-cdata
 // attribute normalization. Returns s, or if the decoded string is longer than
-// s, returns a malloced string that must be freed.
-char *ezxml_decode(char *s, char **ent, char t)
+// s, returns a malloced string that must be freed. If root is arena parsed the
+// longer string comes from its arena instead.
+char *ezxml_decode(char *s, char **ent, char t, ezxml_root_t root)
 {
     char *e, *r = s, *m = s;
     long b, c, d, l;
 
-    for (; *s; s++) { // normalize line endings
-        while (*s == '\r') {
-            *(s++) = '\n';
-            if (*s == '\n') memmove(s, (s + 1), strlen(s));
+    if (*(s = ezxml_scan(s, '\r', '\r'))) { // normalize line endings
+        for (e = s; *s; s++) {
+            if (*s != '\r') *(e++) = *s;
+            else { // \r and \r\n become \n
+                *(e++) = '\n';
+                if (s[1] == '\n') s++;
+            }
         }
+        *e = '\0';
     }
     
     for (s = r; ; ) {
-        while (*s && *s != '&' && (*s != '%' || t != '%') && !isspace(*s)) s++;
+        if (t == ' ' || t == '*') // whitespace is normalized too
+            while (*s && *s != '&' && !isspace(*s)) s++;
+        else s = ezxml_scan(s, '&', (t == '%') ? '%' : '&');
 
         if (! *s) break;
         else if (t != 'c' && ! strncmp(s, "&#", 2)) { // character reference
@@ -196,7 +282,9 @@ char *ezxml_decode(char *s, char **ent, char t)
             if (ent[b++]) { // found a match
                 if ((c = strlen(ent[b])) - 1 > (e = strchr(s, ';')) - s) {
                     l = (d = (s - r)) + c + strlen(e); // new length
-                    r = (r == m) ? strcpy(malloc(l), r) : realloc(r, l);
+                    if (root && root->arena)
+                        r = ezxml_arena_realloc(root, r, strlen(r) + 1, l);
+                    else r = (r == m) ? strcpy(malloc(l), r) : realloc(r, l);
                     e = strchr((s = r + d), ';'); // fix up pointers
                 }
 
@@ -219,12 +307,50 @@ char *ezxml_decode(char *s, char **ent, char t)
     return r;
 }
 
+// same as ezxml_add_child() but takes the new tag from the root's arena
+ezxml_t ezxml_arena_child(ezxml_root_t root, ezxml_t xml, const char *name)
+{
+    ezxml_t child = (ezxml_t)memset(ezxml_arena_alloc(root,
+                                    sizeof(struct ezxml)), '\0',
+                                    sizeof(struct ezxml)), last = root->last;
+    size_t off = EZXML_TXTLEN(xml);
+
+    child->name = (char *)name;
+    child->attr = EZXML_NIL;
+    child->txt = "";
+    child->flags = EZXML_ARENA;
+
+    // The last tag closed in this section is the tail of both its ordered and
+    // next lists, so a repeated tag can be appended without walking them.
+    if (last && last->parent == xml && ! strcmp(last->name, name)) {
+        child->off = off;
+        child->parent = xml;
+        return last->ordered = last->next = child;
+    }
+    return ezxml_insert(child, xml, off);
+}
+
+// copies the l attribute names and values collected in root->tmp into the
+// arena, along with the list of which ones are malloced (none of them)
+char **ezxml_arena_attr(ezxml_root_t root, int l)
+{
+    char **attr = ezxml_arena_alloc(root, (l + 2) * sizeof(char *));
+
+    memcpy(attr, root->tmp, l * sizeof(char *));
+    attr[l] = NULL; // null terminate list
+    attr[l + 1] = memset(ezxml_arena_alloc(root, (l / 2) + 1), ' ', l / 2);
+    attr[l + 1][l / 2] = '\0';
+    return attr;
+}
+
 // called when parser finds start of new tag
 void ezxml_open_tag(ezxml_root_t root, char *name, char **attr)
 {
     ezxml_t xml = root->cur;
     
-    if (xml->name) xml = ezxml_add_child(xml, name, strlen(xml->txt));
+    if (xml->name) xml = (root->arena) ? ezxml_arena_child(root, xml, name)
+                                       : ezxml_add_child(xml, name,
+                                                         strlen(xml->txt));
     else xml->name = name; // first open tag
 
     xml->attr = attr;
@@ -236,12 +362,29 @@ void ezxml_char_content(ezxml_root_t root, char *s, size_t len, char t)
 {
     ezxml_t xml = root->cur;
     char *m = s;
-    size_t l;
+    size_t l, *h;
 
     if (! xml || ! xml->name || ! len) return; // sanity check
 
     s[len] = '\0'; // null terminate text (calling functions anticipate this)
-    len = strlen(s = ezxml_decode(s, root->ent, t)) + 1;
+    len = strlen(s = ezxml_decode(s, root->ent, t, root)) + 1;
+
+    if (root->arena && *(xml->txt)) { // append in the arena
+        l = EZXML_TXTLEN(xml);
+        if (! (xml->flags & EZXML_TXTA) || l + len > ((size_t *)xml->txt)[-1]) {
+            h = ezxml_arena_alloc(root, 2 * sizeof(size_t) + (l + len) * 2);
+            h[1] = (l + len) * 2; // double the space each time it runs out
+            xml->txt = memcpy(h + 2, xml->txt, l);
+            xml->flags |= EZXML_TXTA;
+        }
+        strcpy(xml->txt + l, s);
+        ((size_t *)xml->txt)[-2] = l + len - 1;
+        return;
+    }
+    else if (root->arena) { // initial character content
+        xml->txt = s;
+        return;
+    }
 
     if (! *(xml->txt)) xml->txt = s; // initial character content
     else { // allocate our own memory and make a copy
@@ -261,6 +404,7 @@ ezxml_t ezxml_close_tag(ezxml_root_t root, char *name, char *s)
     if (! root->cur || ! root->cur->name || strcmp(name, root->cur->name))
         return ezxml_err(root, s, "unexpected closing tag </%s>", name);
 
+    root->last = root->cur;
     root->cur = root->cur->parent;
     return NULL;
 }
@@ -347,7 +491,7 @@ short ezxml_internal_dtd(ezxml_root_t root, char *s, size_t len)
 
             *(++s) = '\0'; // null terminate name
             if ((s = strchr(v, q))) *(s++) = '\0'; // null terminate value
-            ent[i + 1] = ezxml_decode(v, pe, '%'); // set value
+            ent[i + 1] = ezxml_decode(v, pe, '%', NULL); // set value
             ent[i + 2] = NULL; // null terminate entity list
             if (! ezxml_ent_ok(n, ent[i + 1], ent)) { // circular reference
                 if (ent[i + 1] != v) free(ent[i + 1]);
@@ -401,8 +545,8 @@ short ezxml_internal_dtd(ezxml_root_t root, char *s, size_t len)
 
                 root->attr[i][j + 3] = NULL; // null terminate list
                 root->attr[i][j + 2] = c; // is it cdata?
-                root->attr[i][j + 1] = (v) ? ezxml_decode(v, root->ent, *c)
-                                           : NULL;
+                root->attr[i][j + 1] = (v) ? ezxml_decode(v, root->ent, *c,
+                                                          NULL) : NULL;
                 root->attr[i][j] = n; // attribute name 
             }
         }
@@ -468,10 +612,9 @@ void ezxml_free_attr(char **attr) {
     free(attr);
 }
 
-// parse the given xml string and return an ezxml structure
-ezxml_t ezxml_parse_str(char *s, size_t len)
+// parses the given xml string into root and returns the root tag
+ezxml_t ezxml_parse_root(ezxml_root_t root, char *s, size_t len)
 {
-    ezxml_root_t root = (ezxml_root_t)ezxml_new(NULL);
     char q, e, *d, **attr, **a = NULL; // initialize a to avoid compile warning
     int l, i, j;
 
@@ -483,7 +626,7 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
     e = s[len - 1]; // save end char
     s[len - 1] = '\0'; // turn end char into null terminator
 
-    while (*s && *s != '<') s++; // find first tag
+    s = ezxml_scan(s, '<', '<'); // find first tag
     if (! *s) return ezxml_err(root, s, "root tag missing");
 
     for (; ; ) {
@@ -501,11 +644,19 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
                 for (i = 0; (a = root->attr[i]) && strcmp(a[0], d); i++);
 
             for (l = 0; *s && *s != '/' && *s != '>'; l += 2) { // new attrib
-                attr = (l) ? realloc(attr, (l + 4) * sizeof(char *))
-                           : malloc(4 * sizeof(char *)); // allocate space
-                attr[l + 3] = (l) ? realloc(attr[l + 1], (l / 2) + 2)
-                                  : malloc(2); // mem for list of maloced vals
-                strcpy(attr[l + 3] + (l / 2), " "); // value is not malloced
+                if (root->arena) { // collect in scratch space, copied below
+                    if (l + 4 > root->tmax)
+                        root->tmp = realloc(root->tmp, (root->tmax = l + 16) *
+                                                       sizeof(char *));
+                    attr = root->tmp;
+                }
+                else {
+                    attr = (l) ? realloc(attr, (l + 4) * sizeof(char *))
+                               : malloc(4 * sizeof(char *)); // allocate space
+                    attr[l + 3] = (l) ? realloc(attr[l + 1], (l / 2) + 2)
+                                      : malloc(2); // list of maloced vals
+                    strcpy(attr[l + 3] + (l / 2), " "); // val is not malloced
+                }
                 attr[l + 2] = NULL; // null terminate list
                 attr[l + 1] = ""; // temporary attribute value
                 attr[l] = s; // set attribute name
@@ -516,27 +667,30 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
                     q = *(s += strspn(s, EZXML_WS "="));
                     if (q == '"' || q == '\'') { // attribute value
                         attr[l + 1] = ++s;
-                        while (*s && *s != q) s++;
+                        s = ezxml_scan(s, q, q);
                         if (*s) *(s++) = '\0'; // null terminate attribute val
                         else {
-                            ezxml_free_attr(attr);
+                            if (! root->arena) ezxml_free_attr(attr);
                             return ezxml_err(root, d, "missing %c", q);
                         }
 
                         for (j = 1; a && a[j] && strcmp(a[j], attr[l]); j +=3);
                         attr[l + 1] = ezxml_decode(attr[l + 1], root->ent, (a
-                                                   && a[j]) ? *a[j + 2] : ' ');
-                        if (attr[l + 1] < d || attr[l + 1] > s)
+                                                   && a[j]) ? *a[j + 2] : ' ',
+                                                   root);
+                        if (! root->arena && (attr[l + 1] < d ||
+                                              attr[l + 1] > s))
                             attr[l + 3][l / 2] = EZXML_TXTM; // value malloced
                     }
                 }
                 while (isspace(*s)) s++;
             }
+            if (root->arena && l) attr = ezxml_arena_attr(root, l);
 
             if (*s == '/') { // self closing tag
                 *(s++) = '\0';
                 if ((*s && *s != '>') || (! *s && e != '>')) {
-                    if (l) ezxml_free_attr(attr);
+                    if (l && ! root->arena) ezxml_free_attr(attr);
                     return ezxml_err(root, d, "missing >");
                 }
                 ezxml_open_tag(root, d, attr);
@@ -548,7 +702,7 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
                 *s = q;
             }
             else {
-                if (l) ezxml_free_attr(attr);
+                if (l && ! root->arena) ezxml_free_attr(attr);
                 return ezxml_err(root, d, "missing >"); 
             }
         }
@@ -589,7 +743,7 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
         *s = '\0';
         d = ++s;
         if (*s && *s != '<') { // tag character content
-            while (*s && *s != '<') s++;
+            s = ezxml_scan(s, '<', '<');
             if (*s) ezxml_char_content(root, d, s - d, '&');
             else break;
         }
@@ -601,6 +755,26 @@ ezxml_t ezxml_parse_str(char *s, size_t len)
     else return ezxml_err(root, d, "unclosed tag <%s>", root->cur->name);
 }
 
+// parse the given xml string and return an ezxml structure
+ezxml_t ezxml_parse_str(char *s, size_t len)
+{
+    return ezxml_parse_root((ezxml_root_t)ezxml_new(NULL), s, len);
+}
+
+// Parses the given xml string with all tags, attribute lists and decoded
+// strings taken from an arena, and returns an ezxml structure. The first block
+// is sized from the input so most documents fit in one allocation.
+ezxml_t ezxml_parse_str_arena(char *s, size_t len)
+{
+    ezxml_root_t root = (ezxml_root_t)ezxml_new(NULL);
+
+    root->arena = malloc(sizeof(struct ezxml_arena) + len + EZXML_BUFSIZE);
+    root->arena->prev = NULL;
+    root->arena->size = len + EZXML_BUFSIZE;
+    root->arena->used = 0;
+    return ezxml_parse_root(root, s, len);
+}
+
 // Wrapper for ezxml_parse_str() that accepts a file stream. Reads the entire
 // stream into memory and then parses it. For xml files, use ezxml_parse_file()
 // or ezxml_parse_fd()
@@ -786,10 +960,11 @@ char *ezxml_toxml(ezxml_t xml)
 void ezxml_free(ezxml_t xml)
 {
     ezxml_root_t root = (ezxml_root_t)xml;
+    ezxml_arena_t arena;
     int i, j;
     char **a, *s;
 
-    if (! xml) return;
+    if (! xml || (xml->flags & EZXML_ARENA)) return; // freed with the arena
     ezxml_free(xml->child);
     ezxml_free(xml->ordered);
 
@@ -817,6 +992,15 @@ void ezxml_free(ezxml_t xml)
         else if (root->len) munmap(root->m, root->len); // mem mapped xml data
 #endif // EZXML_NOMMAP
         if (root->u) free(root->u); // utf8 conversion
+
+        if (root->arena) { // arena parsed, root tag attributes live in it
+            while ((arena = root->arena)) {
+                root->arena = arena->prev;
+                free(arena);
+            }
+            free(root->tmp);
+            root->xml.attr = EZXML_NIL;
+        }
     }
 
     ezxml_free_attr(xml->attr); // tag attributes
@@ -998,6 +1182,499 @@ ezxml_t ezxml_cut(ezxml_t xml)
     return xml;
 }
 
+typedef struct ezxml_pullp *ezxml_pullp_t;
+struct ezxml_pullp {      // additional data for the pull parser
+    struct ezxml_pull pull; // is a super-struct built on top of ezxml_pull
+    char *m;              // input buffer
+    size_t max;           // allocated size of m, 0 if it belongs to the caller
+    size_t len;           // bytes of input in m
+    size_t pos;           // start of the next token in m
+    short eof;            // non-zero once the end of the input is in m
+    short lt;             // non-zero if the '<' at pos was null terminated
+    short empty;          // non-zero if the last start tag was self closing
+    short root;           // non-zero once the root tag has been started
+    char *tag;            // name of the last start tag
+    char **attr;          // attribute names and values of the last start tag
+    int nattr;            // number of entries in attr
+    int iattr;            // next entry in attr to return
+    int amax;             // number of entries allocated for attr
+    char *open;           // names of the open tags, each null terminated
+    size_t olen;          // length of open
+    size_t omax;          // allocated size of open
+    char err[EZXML_ERRL]; // error string
+};
+
+// set an error string for the pull parser and return EZXML_PULL_ERROR
+int ezxml_pull_err(ezxml_pullp_t p, const char *err, ...)
+{
+    va_list ap;
+
+    va_start(ap, err);
+    vsnprintf(p->err, EZXML_ERRL, err, ap);
+    va_end(ap);
+    return EZXML_PULL_ERROR;
+}
+
+// Decodes the predefined entities and character references in s in place and
+// normalizes new lines, and whitespace too if a is non-zero. None of these are
+// longer than their reference, so it never needs more memory. Returns s.
+char *ezxml_pull_decode(char *s, short a)
+{
+    static const char *ent[] = { "lt;", "<", "gt;", ">", "quot;", "\"",
+                                 "apos;", "'", "amp;", "&", NULL };
+    char *r = s, *d, *e;
+    long b, c;
+    int i;
+
+    if (! a) d = s = ezxml_scan(s, '&', '\r'); // skip to the first reference
+    else d = s;
+    while (*s) {
+        if (*s == '&' && s[1] == '#') { // character reference
+            c = (s[2] == 'x') ? strtol(s + 3, &e, 16) : strtol(s + 2, &e, 10);
+            if (c > 0 && c <= 0x10FFFF && *e == ';') {
+                if (c < 0x80) *(d++) = c; // US-ASCII subset
+                else { // multi-byte UTF-8 sequence
+                    for (b = 0, i = c; i; i /= 2) b++; // number of bits in c
+                    b = (b - 2) / 5; // number of bytes in payload
+                    *(d++) = (0xFF << (7 - b)) | (c >> (6 * b)); // head
+                    while (b) *(d++) = 0x80 | ((c >> (6 * --b)) & 0x3F);
+                }
+                s = e + 1;
+                continue;
+            }
+        }
+        else if (*s == '&') { // entity reference
+            for (i = 0; ent[i] && strncmp(s + 1, ent[i], strlen(ent[i]));
+                 i += 2);
+            if (ent[i]) {
+                *(d++) = *ent[i + 1];
+                s += strlen(ent[i]) + 1;
+                continue;
+            }
+        }
+        else if (*s == '\r') { // normalize line endings
+            *(d++) = (a) ? ' ' : '\n';
+            s += (s[1] == '\n') ? 2 : 1;
+            continue;
+        }
+        else if (a && isspace(*s)) { // attribute normalization
+            *(d++) = ' ';
+            s++;
+            continue;
+        }
+        *(d++) = *(s++);
+    }
+    *d = '\0';
+    return r;
+}
+
+// returns the first occurrence of t in s up to e, or NULL if not found
+char *ezxml_pull_find(char *s, char *e, const char *t)
+{
+    size_t l = strlen(t);
+
+    for (; s + l <= e; s++) {
+        if (! (s = memchr(s, *t, e - s - l + 1))) return NULL;
+        if (! memcmp(s, t, l)) return s;
+    }
+    return NULL;
+}
+
+// returns non-zero if the token at s up to e starts with t
+#define ezxml_pull_is(s, e, t) \
+    ((size_t)((e) - (s)) >= sizeof(t) - 1 && ! memcmp(s, t, sizeof(t) - 1))
+
+// returns a new pull parser that takes its input from ezxml_pull_feed()
+ezxml_pull_t ezxml_pull_new(void)
+{
+    ezxml_pullp_t p = (ezxml_pullp_t)memset(malloc(sizeof(struct ezxml_pullp)),
+                                            '\0', sizeof(struct ezxml_pullp));
+    p->m = malloc(p->max = EZXML_BUFSIZE);
+    return &p->pull;
+}
+
+// returns a pull parser over the given xml data, which is modified in place
+ezxml_pull_t ezxml_pull_str(char *s, size_t len)
+{
+    ezxml_pullp_t p = (ezxml_pullp_t)memset(malloc(sizeof(struct ezxml_pullp)),
+                                            '\0', sizeof(struct ezxml_pullp));
+    p->m = s;
+    p->len = len;
+    p->eof = 1;
+    return &p->pull;
+}
+
+// Appends len bytes of input, moving any unparsed input to the start of the
+// buffer first so it only grows to hold the largest token. A len of 0 marks
+// the end of the input. Returns zero if out of memory.
+int ezxml_pull_feed(ezxml_pull_t pull, const char *s, size_t len)
+{
+    ezxml_pullp_t p = (ezxml_pullp_t)pull;
+    char *m;
+
+    if (! p->max || p->eof) return 0; // not an incremental parser
+    if (! len) return p->eof = 1;
+    if (p->lt) p->m[p->pos] = '<'; // put back the start of the next tag
+    p->lt = 0;
+
+    memmove(p->m, p->m + p->pos, p->len -= p->pos);
+    p->pos = 0;
+    if (p->len + len > p->max) {
+        if (! (m = realloc(p->m, p->len + len + EZXML_BUFSIZE))) return 0;
+        p->m = m;
+        p->max = p->len + len + EZXML_BUFSIZE;
+    }
+    memcpy(p->m + p->len, s, len);
+    p->len += len;
+    return 1;
+}
+
+// parses the start tag between s and e (the closing '>'), returns the event
+int ezxml_pull_start(ezxml_pullp_t p, char *s, char *e)
+{
+    char q, *n;
+
+    if (p->pull.depth == 0 && p->root)
+        return ezxml_pull_err(p, "markup outside of root element");
+    if ((p->empty = (e[-1] == '/'))) e--; // self closing tag
+    *e = '\0';
+
+    p->tag = ++s;
+    if (! isalpha(*s) && *s != '_' && *s != ':' && *s >= '\0')
+        return ezxml_pull_err(p, "unexpected <");
+    s += strcspn(s, EZXML_WS);
+    for (p->nattr = p->iattr = 0; *s; p->nattr += 2) { // attributes
+        while (isspace(*s)) *(s++) = '\0'; // null terminate previous token
+        if (! *s) break;
+
+        if (p->nattr + 2 > p->amax)
+            p->attr = realloc(p->attr, (p->amax += 16) * sizeof(char *));
+        p->attr[p->nattr] = n = s; // attribute name
+        p->attr[p->nattr + 1] = ""; // no value
+        s += strcspn(s, EZXML_WS "=");
+        if (*s != '=' && ! isspace(*s)) continue;
+        *(s++) = '\0'; // null terminate attribute name
+        if (! *n) return ezxml_pull_err(p, "malformed attribute in <%s>",
+                                        p->tag);
+        q = *(s += strspn(s, EZXML_WS "="));
+        if (q != '"' && q != '\'') continue; // no value
+
+        p->attr[p->nattr + 1] = ++s;
+        if (! (s = strchr(s, q))) return ezxml_pull_err(p, "missing %c", q);
+        *(s++) = '\0'; // null terminate attribute value
+        ezxml_pull_decode(p->attr[p->nattr + 1], 1);
+    }
+
+    p->root = 1;
+    p->pull.name = p->tag;
+    p->pull.depth++;
+    if (p->empty) return EZXML_PULL_START;
+
+    while (p->olen + strlen(p->tag) + 1 > p->omax) // remember open tag name
+        p->open = realloc(p->open, p->omax += EZXML_BUFSIZE);
+    strcpy(p->open + p->olen, p->tag);
+    p->olen += strlen(p->tag) + 1;
+    return EZXML_PULL_START;
+}
+
+// parses the end tag between s and e (the closing '>'), returns the event
+int ezxml_pull_end(ezxml_pullp_t p, char *s, char *e)
+{
+    char *t;
+
+    *e = '\0';
+    s += 2;
+    s[strcspn(s, EZXML_WS)] = '\0';
+    if (! p->olen) return ezxml_pull_err(p, "unexpected closing tag </%s>", s);
+
+    for (t = p->open + p->olen - 1; t > p->open && t[-1]; t--);
+    if (strcmp(s, t)) return ezxml_pull_err(p, "unexpected closing tag </%s>", s);
+    p->olen = t - p->open;
+    p->pull.name = s;
+    p->pull.depth--;
+    return EZXML_PULL_END;
+}
+
+// returns the next event
+int ezxml_pull_next(ezxml_pull_t pull)
+{
+    ezxml_pullp_t p = (ezxml_pullp_t)pull;
+    char *s, *e, *d;
+
+    pull->name = pull->value = NULL;
+    if (*p->err) return EZXML_PULL_ERROR;
+    if (p->iattr < p->nattr) { // attributes of the last start tag
+        pull->name = p->attr[p->iattr++];
+        pull->value = p->attr[p->iattr++];
+        return EZXML_PULL_ATTR;
+    }
+    if (p->empty) { // end of self closing tag
+        p->empty = 0;
+        pull->name = p->tag;
+        pull->depth--;
+        return EZXML_PULL_END;
+    }
+    if (p->lt) p->m[p->pos] = '<'; // put back the start of this tag
+    p->lt = 0;
+
+    for (; ; ) {
+        s = p->m + p->pos;
+        e = p->m + p->len;
+
+        if (s == e) { // out of input
+            if (! p->eof) return EZXML_PULL_MORE;
+            if (p->olen) {
+                for (d = p->open + p->olen - 1; d > p->open && d[-1]; d--);
+                return ezxml_pull_err(p, "unclosed tag <%s>", d);
+            }
+            if (! p->root) return ezxml_pull_err(p, "root tag missing");
+            return EZXML_PULL_EOF;
+        }
+
+        if (*s != '<') { // character content up to the next tag
+            if (! (d = memchr(s, '<', e - s)) && ! p->eof)
+                return EZXML_PULL_MORE;
+            p->pos = ((d) ? d : e) - p->m;
+            if (! d || ! pull->depth) continue; // outside of the root tag
+            *d = '\0';
+            p->lt = 1;
+            pull->value = ezxml_pull_decode(s, 0);
+            return EZXML_PULL_TEXT;
+        }
+
+        if (e - s < 9 && ! p->eof && memchr(s, '>', e - s) == NULL)
+            return EZXML_PULL_MORE; // not enough to tell what the token is
+
+        if (ezxml_pull_is(s, e, "<!--")) { // xml comment
+            if (! (d = ezxml_pull_find(s + 4, e, "-->"))) goto more;
+            p->pos = d + 3 - p->m;
+        }
+        else if (ezxml_pull_is(s, e, "<![CDATA[")) { // cdata
+            if (! (d = ezxml_pull_find(s + 9, e, "]]>"))) goto more;
+            p->pos = d + 3 - p->m;
+            if (! pull->depth) continue;
+            *d = '\0';
+            pull->value = s + 9;
+            return EZXML_PULL_TEXT;
+        }
+        else if (ezxml_pull_is(s, e, "<?")) { // processing instruction
+            if (! (d = ezxml_pull_find(s + 2, e, "?>"))) goto more;
+            p->pos = d + 2 - p->m;
+        }
+        else if (ezxml_pull_is(s, e, "<!")) { // doctype, skip internal subset
+            for (d = s + 2; d < e && *d != '[' && *d != '>'; d++);
+            if (d < e && *d == '[' && (d = ezxml_pull_find(d, e, "]")))
+                d = ezxml_pull_find(d, e, ">");
+            if (! d || d >= e) goto more;
+            p->pos = d + 1 - p->m;
+        }
+        else { // start or end tag
+            for (d = s + 1; d < e && *d != '>'; d++) // skip quoted values
+                if ((*d == '"' || *d == '\'') &&
+                    ! (d = memchr(d + 1, *d, e - d - 1))) break;
+            if (! d || d >= e) goto more;
+            p->pos = d + 1 - p->m;
+            return (s[1] == '/') ? ezxml_pull_end(p, s, d)
+                                 : ezxml_pull_start(p, s, d);
+        }
+        continue;
+
+    more: // token is incomplete
+        if (! p->eof) return EZXML_PULL_MORE;
+        return ezxml_pull_err(p, "unclosed %.*s", (e - s < 9) ? (int)(e - s)
+                                                               : 9, s);
+    }
+}
+
+// returns the pull parser error message or empty string if none
+const char *ezxml_pull_error(ezxml_pull_t pull)
+{
+    return (pull) ? ((ezxml_pullp_t)pull)->err : "";
+}
+
+// frees a pull parser
+void ezxml_pull_free(ezxml_pull_t pull)
+{
+    ezxml_pullp_t p = (ezxml_pullp_t)pull;
+
+    if (! p) return;
+    if (p->max) free(p->m);
+    free(p->attr);
+    free(p->open);
+    free(p);
+}
+
+struct ezxml_writer {
+    size_t (*write)(void *, const char *, size_t); // output callback or NULL
+    void *opaque;         // passed to write
+    char *m;              // output buffer
+    size_t len;           // bytes in m
+    size_t max;           // allocated size of m
+    size_t total;         // bytes written so far
+    char *open;           // names of the open tags, each null terminated
+    size_t olen;          // length of open
+    size_t omax;          // allocated size of open
+    short tag;            // non-zero while the last start tag takes attributes
+    short err;            // non-zero if a write failed or memory ran out
+};
+
+// sends the buffered output to the write callback
+void ezxml_writer_flush(ezxml_writer_t w)
+{
+    if (w->len && ! w->err && w->write(w->opaque, w->m, w->len) != w->len)
+        w->err = 1;
+    w->len = 0;
+}
+
+// appends len bytes of s to the output
+void ezxml_writer_put(ezxml_writer_t w, const char *s, size_t len)
+{
+    char *m;
+
+    w->total += len;
+    if (w->len + len + 1 > w->max) {
+        if (w->write) { // flush, and pass large strings straight through
+            ezxml_writer_flush(w);
+            if (len >= w->max) {
+                if (! w->err && w->write(w->opaque, s, len) != len) w->err = 1;
+                return;
+            }
+        }
+        else if ((m = realloc(w->m, (w->len + len) * 2 + 1))) {
+            w->m = m; // double the buffer to keep appends linear
+            w->max = (w->len + len) * 2 + 1;
+        }
+        else {
+            w->err = 1;
+            return;
+        }
+    }
+    memcpy(w->m + w->len, s, len);
+    w->len += len;
+}
+
+// Appends s with ampersand sequences encoded, copying runs of characters that
+// don't need it in one go. a is non-zero for attribute values.
+void ezxml_writer_enc(ezxml_writer_t w, const char *s, short a)
+{
+    size_t l;
+
+    for (; ; s++) {
+        ezxml_writer_put(w, s, l = strcspn(s, (a) ? "&<>\"\n\t\r" : "&<>\r"));
+        switch (*(s += l)) {
+        case '\0': return;
+        case '&': ezxml_writer_put(w, "&amp;", 5); break;
+        case '<': ezxml_writer_put(w, "&lt;", 4); break;
+        case '>': ezxml_writer_put(w, "&gt;", 4); break;
+        case '"': ezxml_writer_put(w, "&quot;", 6); break;
+        case '\n': ezxml_writer_put(w, "&#xA;", 5); break;
+        case '\t': ezxml_writer_put(w, "&#x9;", 5); break;
+        case '\r': ezxml_writer_put(w, "&#xD;", 5); break;
+        }
+    }
+}
+
+// returns a new streaming xml writer
+ezxml_writer_t ezxml_writer_new(size_t (*write)(void *opaque, const char *s,
+                                                size_t len), void *opaque)
+{
+    ezxml_writer_t w = (ezxml_writer_t)memset(malloc(
+                           sizeof(struct ezxml_writer)), '\0',
+                           sizeof(struct ezxml_writer));
+    w->write = write;
+    w->opaque = opaque;
+    w->m = malloc(w->max = EZXML_BUFSIZE * 4);
+    return w;
+}
+
+// starts a tag with the given name
+ezxml_writer_t ezxml_write_open(ezxml_writer_t w, const char *name)
+{
+    size_t l = strlen(name) + 1;
+    char *o;
+
+    if (w->tag) ezxml_writer_put(w, ">", 1); // finish the parent's start tag
+    ezxml_writer_put(w, "<", 1);
+    ezxml_writer_put(w, name, l - 1);
+    w->tag = 1;
+
+    if (w->olen + l > w->omax) { // remember the name for ezxml_write_close()
+        if (! (o = realloc(w->open, w->omax += l + EZXML_BUFSIZE))) {
+            w->err = 1;
+            return w;
+        }
+        w->open = o;
+    }
+    memcpy(w->open + w->olen, name, l);
+    w->olen += l;
+    return w;
+}
+
+// adds an attribute to the tag that was just started
+ezxml_writer_t ezxml_write_attr(ezxml_writer_t w, const char *name,
+                                const char *value)
+{
+    if (! w->tag) { // already wrote text or a sub tag
+        w->err = 1;
+        return w;
+    }
+    ezxml_writer_put(w, " ", 1);
+    ezxml_writer_put(w, name, strlen(name));
+    ezxml_writer_put(w, "=\"", 2);
+    ezxml_writer_enc(w, value, 1);
+    ezxml_writer_put(w, "\"", 1);
+    return w;
+}
+
+// writes character content into the current tag
+ezxml_writer_t ezxml_write_text(ezxml_writer_t w, const char *txt)
+{
+    if (w->tag) ezxml_writer_put(w, ">", 1);
+    w->tag = 0;
+    ezxml_writer_enc(w, txt, 0);
+    return w;
+}
+
+// closes the current tag
+ezxml_writer_t ezxml_write_close(ezxml_writer_t w)
+{
+    char *name;
+
+    if (! w->olen) return w; // nothing open
+    for (name = w->open + w->olen - 1; name > w->open && name[-1]; name--);
+    w->olen = name - w->open;
+
+    if (w->tag) ezxml_writer_put(w, "/>", 2);
+    else {
+        ezxml_writer_put(w, "</", 2);
+        ezxml_writer_put(w, name, strlen(name));
+        ezxml_writer_put(w, ">", 1);
+    }
+    w->tag = 0;
+    return w;
+}
+
+// closes any open tags, flushes and frees the writer
+int ezxml_writer_free(ezxml_writer_t w, char **xml, size_t *len)
+{
+    int ok;
+
+    while (w->olen) ezxml_write_close(w);
+    if (w->write) ezxml_writer_flush(w);
+    if ((ok = ! w->err) && xml && ! w->write) {
+        w->m[w->len] = '\0';
+        *xml = w->m;
+        w->m = NULL;
+    }
+    else if (xml) *xml = NULL;
+    if (len) *len = w->total;
+
+    free(w->m);
+    free(w->open);
+    free(w);
+    return ok;
+}
+
 #ifdef EZXML_TEST // test harness
 int main(int argc, char **argv)
 {
@@ -1015,3 +1692,73 @@ int main(int argc, char **argv)
     return (i) ? 1 : 0;
 }
 #endif // EZXML_TEST
+
+#ifdef EZXML_BENCH // parser benchmark: ezxml_bench [entries] [xmlfile ...]
+#include <time.h>
+
+// parses len bytes of xml repeatedly with each parser and prints throughput
+void ezxml_bench(const char *name, const char *xml, size_t len)
+{
+    static const char *mode[] = { "malloc", "arena", "pull" };
+    int i, k, runs = (len < (1 << 20)) ? (64 << 20) / len : 64;
+    char *s = malloc(len + 1);
+    clock_t t, parse[3] = { 0, 0, 0 }, release[3] = { 0, 0, 0 };
+    ezxml_t x;
+    ezxml_pull_t p;
+
+    printf("%s: %zu bytes\n", name, len);
+    for (i = 0; i < runs * 3; i++) {
+        memcpy(s, xml, len + 1);
+        t = clock();
+        if (i % 3 == 2) { // pull every event
+            p = ezxml_pull_str(s, len);
+            while ((k = ezxml_pull_next(p)) > 0);
+            parse[2] += clock() - t;
+            if (k < 0) printf("  %s\n", ezxml_pull_error(p));
+            ezxml_pull_free(p);
+            if (k < 0) break;
+            continue;
+        }
+        x = (i % 3) ? ezxml_parse_str_arena(s, len) : ezxml_parse_str(s, len);
+        parse[i % 3] += clock() - t;
+        if (*ezxml_error(x)) printf("  %s\n", ezxml_error(x));
+        t = clock();
+        ezxml_free(x);
+        release[i % 3] += clock() - t;
+    }
+
+    for (i = 0; i < 3; i++)
+        printf("  %-6s %9.1f MB/s  free %8.3f ms\n", mode[i], (double)len *
+               runs / (1 << 20) / ((double)parse[i] / CLOCKS_PER_SEC + 1e-9),
+               release[i] * 1000.0 / CLOCKS_PER_SEC / runs);
+    free(s);
+}
+
+int main(int argc, char **argv)
+{
+    int i, n = (argc > 1) ? atoi(argv[1]) : 10000;
+    size_t l, len = 0, max = 128 + n * 96;
+    char *xml = malloc(max);
+    FILE *fp;
+
+    len += sprintf(xml + len, "<woomy><metadata><name>Bench &amp; Co</name>"
+                   "<icon>0</icon></metadata><entries>\n");
+    for (i = 0; i < n; i++)
+        len += sprintf(xml + len, "<entry name=\"Entry %d &lt;%d&gt;\" "
+                       "folder=\"%08x/\" entries=\"%d\">n%d</entry>\n",
+                       i, i % 7, i, i % 1000, i);
+    len += sprintf(xml + len, "</entries></woomy>");
+    ezxml_bench("generated manifest", xml, len);
+
+    for (i = 2; i < argc; i++) { // project files such as meta.xml or cos.xml
+        if (! (fp = fopen(argv[i], "rb"))) continue;
+        for (len = 0; (l = fread(xml + len, 1, max - len - 1, fp)); len += l)
+            if (len + l + 1 == max) xml = realloc(xml, max *= 2);
+        xml[len] = '\0';
+        fclose(fp);
+        ezxml_bench(argv[i], xml, len);
+    }
+    free(xml);
+    return 0;
+}
+#endif // EZXML_BENCH
@@ -39,6 +39,7 @@ extern "C" {
 #define EZXML_NAMEM   0x80 // name is malloced
 #define EZXML_TXTM    0x40 // txt is malloced
 #define EZXML_DUP     0x20 // attribute name and value are strduped
+#define EZXML_ARENA   0x10 // tag was allocated from its document's arena
 
 typedef struct ezxml *ezxml_t;
 struct ezxml {
@@ -60,6 +61,12 @@ struct ezxml {
 // pass in the copy. Returns NULL on failure.
 ezxml_t ezxml_parse_str(char *s, size_t len);
 
+// Same as ezxml_parse_str(), but every tag, attribute list and decoded string
+// is taken from a bump allocated arena, and ezxml_free() releases the whole
+// document at once instead of walking the tree. The result is meant to be
+// read only: don't add tags, set text or set attributes on it.
+ezxml_t ezxml_parse_str_arena(char *s, size_t len);
+
 // A wrapper for ezxml_parse_str() that accepts a file descriptor. First
 // attempts to mem map the file. Failing that, reads the file into memory.
 // Returns NULL on failure.
@@ -161,6 +168,79 @@ ezxml_t ezxml_insert(ezxml_t xml, ezxml_t dest, size_t off);
 // removes a tag along with all its subtags
 #define ezxml_remove(xml) ezxml_free(ezxml_cut(xml))
 
+// Pull parser. Instead of building a tree, ezxml_pull_next() returns one event
+// at a time, so a document can be read in constant memory as it arrives.
+// Only the predefined entities and character references are decoded, and
+// declarations, comments and processing instructions are skipped.
+#define EZXML_PULL_ERROR -1 // parse error, see ezxml_pull_error()
+#define EZXML_PULL_EOF    0 // end of document
+#define EZXML_PULL_START  1 // start tag, name is set
+#define EZXML_PULL_ATTR   2 // attribute of the last start tag, name and value
+#define EZXML_PULL_TEXT   3 // character content (including whitespace), value
+#define EZXML_PULL_END    4 // end tag, name is set, also sent for <tag/>
+#define EZXML_PULL_MORE   5 // more input is needed, see ezxml_pull_feed()
+
+typedef struct ezxml_pull *ezxml_pull_t;
+struct ezxml_pull {
+    char *name;  // tag or attribute name of the current event
+    char *value; // attribute value or character content of the current event
+    int depth;   // number of open tags, including the one just started
+};
+
+// returns a new pull parser that takes its input from ezxml_pull_feed()
+ezxml_pull_t ezxml_pull_new(void);
+
+// Returns a pull parser over the given xml data. Like ezxml_parse_str(), the
+// data is modified in place to null terminate and decode names and values.
+ezxml_pull_t ezxml_pull_str(char *s, size_t len);
+
+// Appends len bytes of input to a parser from ezxml_pull_new(). Call it only
+// after ezxml_pull_next() returns EZXML_PULL_MORE. A len of 0 marks the end of
+// the input. Returns zero if out of memory.
+int ezxml_pull_feed(ezxml_pull_t pull, const char *s, size_t len);
+
+// Returns the next event. The name and value strings are only valid until the
+// next call to ezxml_pull_next() or ezxml_pull_feed().
+int ezxml_pull_next(ezxml_pull_t pull);
+
+// returns the pull parser error message or empty string if none
+const char *ezxml_pull_error(ezxml_pull_t pull);
+
+// frees a pull parser
+void ezxml_pull_free(ezxml_pull_t pull);
+
+// Streaming writer. Tags are written as they are opened and attribute values
+// and text are escaped on the way out, so output takes linear time. Tag and
+// attribute names are written as given and must already be valid xml names.
+// Without a write callback the xml is collected in a buffer that can be handed
+// straight to mz_zip_writer_add_mem().
+typedef struct ezxml_writer *ezxml_writer_t;
+
+// Returns a new writer. If write is not NULL, output is passed to it in blocks
+// of EZXML_BUFSIZE or more and it must return the number of bytes it wrote.
+ezxml_writer_t ezxml_writer_new(size_t (*write)(void *opaque, const char *s,
+                                                size_t len), void *opaque);
+
+// starts a tag with the given name, written unescaped, and returns the writer
+ezxml_writer_t ezxml_write_open(ezxml_writer_t w, const char *name);
+
+// Adds an attribute to the tag that was just started. Must come before any
+// text or sub tags. Only the value is escaped. Returns the writer.
+ezxml_writer_t ezxml_write_attr(ezxml_writer_t w, const char *name,
+                                const char *value);
+
+// writes character content into the current tag and returns the writer
+ezxml_writer_t ezxml_write_text(ezxml_writer_t w, const char *txt);
+
+// closes the current tag, as <tag/> if it is empty, and returns the writer
+ezxml_writer_t ezxml_write_close(ezxml_writer_t w);
+
+// Closes any open tags, flushes and frees the writer. Returns zero if a write
+// failed or memory ran out. Without a write callback, if xml is not NULL it is
+// set to the malloced, null terminated output, which must be freed. If len is
+// not NULL it is set to the total number of bytes written.
+int ezxml_writer_free(ezxml_writer_t w, char **xml, size_t *len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,7 +12,11 @@
  * $Id: font.c 540 2005-07-08 19:35:10Z warren $
  */
 
+#ifdef DRAW_HEADLESS
+#include "draw.h"
+#else
 #include <wut.h>
+#endif
 
 const u8 msx_font[] __attribute((aligned(4))) = {
     0x00, 0x18, 0x24, 0x24, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -0,0 +1,101 @@
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+#include <coreinit/thread.h>
+#include <coreinit/time.h>
+
+#include "frame.h"
+
+//Pacing for the render thread. main only polls input, the render thread
+//shares the memory bus with the install and extraction threads, and the UI is
+//mostly still, so it only draws as often as what's on screen needs. Each frame
+//picks a rate, decides whether the TV can be skipped, and sleeps off whatever
+//is left of it once drawing is done.
+
+//How long after the last input the render thread stays at the fast rate
+#define FRAME_INPUT_HOLD_MS 1000
+#define FRAME_STATS_MS 500
+
+FrameStats frameStats;
+
+static OSTime lastInput = 0;
+static OSTime frameStart = 0;
+static OSTime nextFrame = 0;
+static u32 frameCount = 0;
+
+static OSTime statsStart = 0;
+static OSTime statsRender = 0;
+static OSTime statsRenderMax = 0;
+static u32 statsFrames = 0;
+
+static int pickRate(bool input, bool installing, bool extracting)
+{
+    OSTime now = OSGetSystemTime();
+    if(input)
+        lastInput = now;
+    bool active = lastInput && now - lastInput < OSMillisecondsToTicks(FRAME_INPUT_HOLD_MS);
+    
+    //Extraction is bound by the SD card, so the UI backs off the hardest
+    if(extracting)
+        return active ? FRAME_RATE_NORMAL : FRAME_RATE_SLOW;
+    if(active)
+        return FRAME_RATE_FAST;
+    if(installing)
+        return FRAME_RATE_NORMAL;
+    return FRAME_RATE_SLOW;
+}
+
+void frameBegin(bool input, bool installing, bool extracting)
+{
+    frameStart = OSGetSystemTime();
+    frameStats.rate = pickRate(input, installing, extracting);
+    frameStats.skippingTV = extracting;
+    frameCount++;
+}
+
+//While extracting, input happens on the gamepad and the TV only gets every
+//other frame
+bool frameDrawScreen(int screen)
+{
+    return screen != SCREEN_TOP || !frameStats.skippingTV || !(frameCount & 1);
+}
+
+void frameEnd()
+{
+    OSTime now = OSGetSystemTime();
+    OSTime render = now - frameStart;
+    
+    statsRender += render;
+    if(render > statsRenderMax)
+        statsRenderMax = render;
+    statsFrames++;
+    
+    if(!statsStart)
+        statsStart = now;
+    if(now - statsStart >= OSMillisecondsToTicks(FRAME_STATS_MS))
+    {
+        frameStats.renderUs = OSTicksToMicroseconds(statsRender / statsFrames);
+        frameStats.renderMaxUs = OSTicksToMicroseconds(statsRenderMax);
+        frameStats.frameUs = OSTicksToMicroseconds((now - statsStart) / statsFrames);
+        statsStart = now;
+        statsRender = 0;
+        statsRenderMax = 0;
+        statsFrames = 0;
+    }
+    
+    //Frames are due a fixed period apart. Running late starts the next one
+    //right away instead of trying to catch up.
+    OSTime period = OSSecondsToTicks(1) / frameStats.rate;
+    nextFrame += period;
+    if(nextFrame < now)
+        nextFrame = now;
+    else
+        OSSleepTicks(nextFrame - now);
+}
@@ -0,0 +1,24 @@
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+#include "ui.h"
+
+#define FRAME_RATE_FAST 60
+#define FRAME_RATE_NORMAL 30
+#define FRAME_RATE_SLOW 15
+
+extern FrameStats frameStats;
+
+void frameBegin(bool input, bool installing, bool extracting);
+bool frameDrawScreen(int screen);
+void frameEnd();
+#endif /* FRAME_H */
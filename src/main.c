@@ -11,6 +11,9 @@
 #include <coreinit/core.h>
 #include <coreinit/debug.h>
 #include <coreinit/thread.h>
+#include <coreinit/mutex.h>
+#include <coreinit/semaphore.h>
+#include <coreinit/time.h>
 #include <coreinit/filesystem.h>
 #include <coreinit/foreground.h>
 #include <coreinit/screen.h>
@@ -21,6 +24,7 @@
 #include <vpad/input.h>
 
 #include <dirent.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -28,16 +32,24 @@
 #include "ezxml.h"
 #include "draw.h"
 #include "memory.h"
+#include "woomy.h"
+#include "ui.h"
+#include "frame.h"
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #define MAX(a,b) (((a)>(b))?(a):(b))
 
-typedef struct InstallDevice
+typedef struct WoomyEntry
 {
-    int deviceID;
-    int deviceNum;
-    char *deviceName;
-} InstallDevice;
+    const char *name;
+    const char *folder;
+    size_t folderLen;
+    u32 count;
+    int firstFile;
+    int numFiles;
+    u64 compTotal;
+    u64 uncompTotal;
+} WoomyEntry;
 
 FSClient *fsClient;
 
@@ -47,6 +59,7 @@ bool buttonState = false;
 bool lastButtonState = false;
 
 bool screenSwap = false;
+bool showFrameStats = false;
 bool isAppRunning = true;
 bool initialized = false;
 int scrollPos = 0;
@@ -64,11 +77,18 @@ char *currentIOSDirectory;
 int numEntries;
 int dirLevel = 0;
 
-#define INSTALL_QUEUE_SIZE 0x100
 char **installQueue;
 u8 *installQueueTarget;
 char *currentlyInstalling;
 bool installing = false;
+
+//Held while the install thread changes anything the screens show, and while
+//the main thread copies it into a snapshot
+OSMutex stateLock;
+
+//Held by the render thread while it draws, and by ProcUI handling while the
+//screen buffers are set up or released
+OSMutex screenLock;
 MCPInstallProgress *mcp_prog_buf;
 int mcp_handle;
 
@@ -101,6 +121,8 @@ void screenInit()
     OSScreenEnableEx(1, 1);
     
     clearScreen(0,0,0,0);
+    markScreenDirty(SCREEN_TOP);
+    markScreenDirty(SCREEN_BOTTOM);
 }
 
 void screenDeinit()
@@ -137,8 +159,10 @@ bool AppRunning()
           
           if(initialized)
           {
+              OSLockMutex(&screenLock);
               initialized = false;
               screenDeinit();
+              OSUnlockMutex(&screenLock);
               memoryRelease();
               FSShutdown();
           }
@@ -148,9 +172,11 @@ bool AppRunning()
       else if(status == PROCUI_STATUS_RELEASE_FOREGROUND)
       {
           // Free up MEM1 to next foreground app, etc.
+          OSLockMutex(&screenLock);
           initialized = false;
           
           screenDeinit();
+          OSUnlockMutex(&screenLock);
           memoryRelease();
           ProcUIDrawDoneRelease();
       }
@@ -159,10 +185,12 @@ bool AppRunning()
          // Reallocate MEM1, reinit screen, etc.
          if(!initialized)
          {
+            OSLockMutex(&screenLock);
             initialized = true;
             
             memoryInitialize();
             screenInit();
+            OSUnlockMutex(&screenLock);
          }
       }
    }
@@ -263,6 +291,7 @@ void moveUpDirectory()
 
 void shiftBackInstallQueue()
 {
+    OSLockMutex(&stateLock);
     for(int i = 1; i < INSTALL_QUEUE_SIZE; i++)
     {
         installQueue[i-1] = installQueue[i];
@@ -270,16 +299,19 @@ void shiftBackInstallQueue()
         if(installQueue[i] == NULL)
             break;
     }
+    OSUnlockMutex(&stateLock);
 }
 
 void addToInstallQueue(char *path)
 {
     OSReport("Attempting to add %s to the install queue...", path);
+    OSLockMutex(&stateLock);
     if(currentlyInstalling != NULL)
     {
         if(!strcmp(currentlyInstalling, path))
         {
             OSReport("%s is being installed", path);
+            OSUnlockMutex(&stateLock);
             return;
         }
     }
@@ -292,7 +324,7 @@ void addToInstallQueue(char *path)
             if(!strcmp(installQueue[i], path))
             {
                 OSReport("%s is already in the install queue", path);
-                return;
+                break;
             }
         }
         else
@@ -304,12 +336,14 @@ void addToInstallQueue(char *path)
             break;
         }
     }
+    OSUnlockMutex(&stateLock);
 }
 
 mz_zip_archive woomy_archive = {0};
 ezxml_t woomy_xml;
 bool has_icon = false;
 void *icon_mem;
+Surface icon_surface;
 int woomy_install_index = 0;
 int woomy_extract_prog = 0;
 int woomy_extract_total = 0;
@@ -318,6 +352,296 @@ bool woomy_extracting = false;
 
 char *woomy_archive_name;
 char *woomy_entry_name;
+char *woomy_meta_buf = NULL;
+bool woomy_wants_icon = false;
+
+WoomyEntry *woomy_entries = NULL;
+int woomy_num_entries = 0;
+int *woomy_entry_files = NULL;
+
+//Extracts metadata.xml into a buffer sized from the central directory and parses it in place.
+//ezxml points into the buffer, so it lives until the archive job is done. The tree is only
+//read, so it's arena parsed and freeWoomyMetadata releases it in one go.
+ezxml_t loadWoomyMetadata(mz_zip_archive *archive)
+{
+    mz_zip_archive_file_stat file_stat;
+    int index = mz_zip_reader_locate_file(archive, "metadata.xml", NULL, 0);
+    if(index < 0 || !mz_zip_reader_file_stat(archive, index, &file_stat) || !file_stat.m_uncomp_size || file_stat.m_uncomp_size >= SIZE_MAX)
+        return NULL;
+    
+    woomy_meta_buf = malloc((size_t)file_stat.m_uncomp_size + 1);
+    if(!woomy_meta_buf)
+        return NULL;
+    
+    if(!mz_zip_reader_extract_to_mem(archive, index, woomy_meta_buf, (size_t)file_stat.m_uncomp_size, 0))
+    {
+        free(woomy_meta_buf);
+        woomy_meta_buf = NULL;
+        return NULL;
+    }
+    woomy_meta_buf[file_stat.m_uncomp_size] = 0;
+    
+    ezxml_t xml = ezxml_parse_str_arena(woomy_meta_buf, (size_t)file_stat.m_uncomp_size);
+    if(xml && *ezxml_error(xml))
+        OSReport("metadata.xml: %s\n", ezxml_error(xml));
+    return xml;
+}
+
+//Flattens the <entry> list into woomy_entries and matches every file in the archive to its
+//entries once, so installing n entries doesn't walk the tree or central directory n times.
+//Strings point into the metadata tree.
+bool compileWoomyEntries(mz_zip_archive *archive, ezxml_t xml)
+{
+    mz_zip_archive_file_stat file_stat;
+    int num_files = (int)mz_zip_reader_get_num_files(archive);
+    int total = 0;
+    
+    ezxml_t entries = ezxml_get(xml, "entries", 0, "entry", -1);
+    for(ezxml_t entry = entries; entry; entry = ezxml_next(entry))
+        woomy_num_entries++;
+    
+    woomy_entries = calloc(woomy_num_entries + 1, sizeof(WoomyEntry));
+    if(!woomy_entries)
+        return false;
+    
+    WoomyEntry *out = woomy_entries;
+    for(ezxml_t entry = entries; entry; entry = ezxml_next(entry), out++)
+    {
+        const char *count = ezxml_attr(entry, "entries");
+        out->name = ezxml_attr(entry, "name");
+        out->folder = ezxml_attr(entry, "folder");
+        out->count = count ? (u32)(strtoul(count, NULL, 10) & 0xFFFFFFFF) : 0;
+        
+        if(!out->name)
+            out->name = "<no name>";
+        if(!out->folder)
+            out->folder = "";
+        out->folderLen = strlen(out->folder);
+    }
+    
+    //Count and total up each entry's files, then lay their indices out back to back
+    for(int pass = 0; pass < 2; pass++)
+    {
+        for(int i = 0; i < num_files; i++)
+        {
+            if(mz_zip_reader_is_file_a_directory(archive, i) || !mz_zip_reader_file_stat(archive, i, &file_stat))
+                continue;
+            
+            for(int j = 0; j < woomy_num_entries; j++)
+            {
+                WoomyEntry *entry = &woomy_entries[j];
+                if(strncmp(file_stat.m_filename, entry->folder, entry->folderLen))
+                    continue;
+                
+                if(pass)
+                {
+                    woomy_entry_files[entry->firstFile + entry->numFiles++] = i;
+                    continue;
+                }
+                
+                entry->numFiles++;
+                entry->compTotal += file_stat.m_comp_size;
+                entry->uncompTotal += file_stat.m_uncomp_size;
+                total++;
+            }
+        }
+        
+        if(pass)
+            break;
+        
+        woomy_entry_files = malloc((total + 1) * sizeof(int));
+        if(!woomy_entry_files)
+            return false;
+        
+        for(int j = 0, first = 0; j < woomy_num_entries; j++)
+        {
+            woomy_entries[j].firstFile = first;
+            first += woomy_entries[j].numFiles;
+            woomy_entries[j].numFiles = 0;
+        }
+    }
+    
+    ezxml_t name = ezxml_get(xml, "metadata", 0, "name", -1);
+    woomy_archive_name = name ? name->txt : "<no name>";
+    woomy_wants_icon = !strcmp(ezxml_txt(ezxml_get(xml, "metadata", 0, "icon", -1)), "1");
+    
+    OSReport("Compiled %u woomy entries covering %u files\n", woomy_num_entries, total);
+    return true;
+}
+
+void freeWoomyMetadata()
+{
+    free(woomy_entries);
+    woomy_entries = NULL;
+    woomy_num_entries = 0;
+    free(woomy_entry_files);
+    woomy_entry_files = NULL;
+    
+    ezxml_free(woomy_xml);
+    woomy_xml = NULL;
+    free(woomy_meta_buf);
+    woomy_meta_buf = NULL;
+    woomy_wants_icon = false;
+}
+
+//Loads metadata.bin, the precompiled metadata newer packers store next to metadata.xml, straight
+//into the entry table. Strings point into the blob. Returns false if it's missing or doesn't
+//match the archive, in which case metadata.xml is used instead.
+bool loadWoomyBinaryMetadata(mz_zip_archive *archive)
+{
+    mz_zip_archive_file_stat file_stat;
+    int index = mz_zip_reader_locate_file(archive, "metadata.bin", NULL, 0);
+    if(index < 0 || !mz_zip_reader_file_stat(archive, index, &file_stat) || file_stat.m_uncomp_size < sizeof(WoomyBinHeader) || file_stat.m_uncomp_size >= SIZE_MAX)
+        return false;
+    
+    u64 size = file_stat.m_uncomp_size;
+    woomy_meta_buf = memalign(0x40, (size_t)size);
+    if(!woomy_meta_buf || !mz_zip_reader_extract_to_mem(archive, index, woomy_meta_buf, (size_t)size, 0))
+        goto fail;
+    
+    WoomyBinHeader *header = (WoomyBinHeader*)woomy_meta_buf;
+    u32 num_entries = WOOMY_BE32(header->numEntries);
+    u32 num_files = WOOMY_BE32(header->numFiles);
+    u32 entries_offset = WOOMY_BE32(header->entriesOffset);
+    u32 files_offset = WOOMY_BE32(header->filesOffset);
+    u32 strings_offset = WOOMY_BE32(header->stringsOffset);
+    u32 strings_size = WOOMY_BE32(header->stringsSize);
+    char *strings = woomy_meta_buf + strings_offset;
+    
+    if(WOOMY_BE32(header->magic) != WOOMY_BIN_MAGIC || WOOMY_BE32(header->version) != WOOMY_BIN_VERSION
+       || (entries_offset | files_offset) & 7
+       || entries_offset + (u64)num_entries * sizeof(WoomyBinEntry) > size
+       || files_offset + (u64)num_files * sizeof(WoomyBinFile) > size
+       || !strings_size || strings_offset + (u64)strings_size > size || strings[strings_size-1]
+       || WOOMY_BE32(header->nameOffset) >= strings_size)
+    {
+        OSReport("metadata.bin: unsupported or malformed header\n");
+        goto fail;
+    }
+    
+    woomy_entries = calloc(num_entries + 1, sizeof(WoomyEntry));
+    woomy_entry_files = malloc((num_files + 1) * sizeof(int));
+    if(!woomy_entries || !woomy_entry_files)
+        goto fail;
+    
+    WoomyBinFile *files = (WoomyBinFile*)(woomy_meta_buf + files_offset);
+    for(u32 i = 0; i < num_files; i++)
+    {
+        u32 file_index = WOOMY_BE32(files[i].fileIndex);
+        if(file_index >= mz_zip_reader_get_num_files(archive) || !mz_zip_reader_file_stat(archive, file_index, &file_stat)
+           || file_stat.m_local_header_ofs != WOOMY_BE64(files[i].localHeaderOffset))
+        {
+            OSReport("metadata.bin: file %u doesn't match the archive\n", i);
+            goto fail;
+        }
+        woomy_entry_files[i] = (int)file_index;
+    }
+    
+    WoomyBinEntry *entries = (WoomyBinEntry*)(woomy_meta_buf + entries_offset);
+    for(u32 i = 0; i < num_entries; i++)
+    {
+        WoomyEntry *out = &woomy_entries[i];
+        u32 name_offset = WOOMY_BE32(entries[i].nameOffset);
+        u32 folder_offset = WOOMY_BE32(entries[i].folderOffset);
+        out->firstFile = (int)WOOMY_BE32(entries[i].firstFile);
+        out->numFiles = (int)WOOMY_BE32(entries[i].numFiles);
+        if(name_offset >= strings_size || folder_offset >= strings_size
+           || (u64)(u32)out->firstFile + (u32)out->numFiles > num_files)
+        {
+            OSReport("metadata.bin: entry %u is malformed\n", i);
+            goto fail;
+        }
+        
+        out->name = strings + name_offset;
+        out->folder = strings + folder_offset;
+        out->folderLen = strlen(out->folder);
+        out->count = WOOMY_BE32(entries[i].count);
+        out->compTotal = WOOMY_BE64(entries[i].compTotal);
+        out->uncompTotal = WOOMY_BE64(entries[i].uncompTotal);
+    }
+    
+    woomy_num_entries = (int)num_entries;
+    woomy_archive_name = strings + WOOMY_BE32(header->nameOffset);
+    woomy_wants_icon = !!(WOOMY_BE32(header->flags) & WOOMY_BIN_FLAG_ICON);
+    OSReport("Loaded %u woomy entries covering %u files from metadata.bin\n", num_entries, num_files);
+    return true;
+
+fail:
+    freeWoomyMetadata();
+    return false;
+}
+
+//Extracted data is checksummed on core 0 while core 2 writes it out
+OSSemaphore crc_job_sema;
+OSSemaphore crc_done_sema;
+const void *crc_job_buf;
+size_t crc_job_len;
+mz_ulong crc_job_value;
+bool crc_job_pending = false;
+bool crc_worker_running = true;
+OSMutex crcLock;
+OSThread crcThread;
+u8 crcStack[0x4000] __attribute__((aligned(16)));
+
+//Every wake is either a job or, once crc_worker_running is cleared, the one
+//telling it to exit so it can be joined
+int crcWorker(int argc, const char **argv)
+{
+    while(true)
+    {
+        OSWaitSemaphore(&crc_job_sema);
+        if(!crc_job_pending)
+            break;
+        crc_job_value = mz_crc32(crc_job_value, crc_job_buf, crc_job_len);
+        crc_job_pending = false;
+        OSSignalSemaphore(&crc_done_sema);
+    }
+    return 0;
+}
+
+size_t extractWriteCallback(void *opaque, mz_uint64 ofs, const void *buf, size_t n)
+{
+    //The install thread isn't joined on exit, so an extract still running
+    //then checksums the rest itself
+    OSLockMutex(&crcLock);
+    bool offload = crc_worker_running;
+    if(offload)
+    {
+        crc_job_buf = buf;
+        crc_job_len = n;
+        crc_job_pending = true;
+        OSSignalSemaphore(&crc_job_sema);
+    }
+    OSUnlockMutex(&crcLock);
+    if(!offload)
+        crc_job_value = mz_crc32(crc_job_value, buf, n);
+    
+    size_t written = fwrite(buf, 1, n, (FILE*)opaque);
+    
+    //The buffer is only ours until we return
+    if(offload)
+        OSWaitSemaphore(&crc_done_sema);
+    return written;
+}
+
+bool extractFile(int index, mz_zip_archive_file_stat *file_stat, char *path)
+{
+    FILE *out = fopen(path, "wb");
+    if(!out)
+        return false;
+    
+    crc_job_value = MZ_CRC32_INIT;
+    bool status = mz_zip_reader_extract_to_callback(&woomy_archive, index, extractWriteCallback, out, MZ_ZIP_FLAG_NO_CRC32_CHECK);
+    if(fclose(out) == EOF)
+        status = false;
+    
+    if(status && crc_job_value != file_stat->m_crc32)
+    {
+        OSReport("CRC mismatch for '%s', expected %08x got %08x\n", file_stat->m_filename, file_stat->m_crc32, (u32)crc_job_value);
+        status = false;
+    }
+    return status;
+}
 
 void processInstallQueue(int argc, const char **argv)
 {
@@ -351,6 +675,7 @@ void processInstallQueue(int argc, const char **argv)
         
         if(!mcp_install->inProgress)
         {
+            OSLockMutex(&stateLock);
             installing = false;
             
             //Free queue allocations
@@ -360,43 +685,43 @@ void processInstallQueue(int argc, const char **argv)
                 currentlyInstalling = NULL;
             }
             
-            if(installQueue[0] == NULL)
-                continue;
-                
+            //The main thread may be adding to an empty queue
             char *to_install = installQueue[0];
+            OSUnlockMutex(&stateLock);
+            if(to_install == NULL)
+                continue;
             
             //If it's a file, attempt to process it
             if(to_install[strlen(to_install)-1] != '/')
             {
                 if(!woomy_processing)
                 {
+                    OSLockMutex(&stateLock);
                     woomy_extracting = false;
+                    OSUnlockMutex(&stateLock);
                     if(mz_zip_reader_init_file(&woomy_archive, to_install, 0))
                     {
-                        void *meta_buf = malloc(0x8000);
-                        int status = mz_zip_reader_extract_file_to_mem(&woomy_archive, "metadata.xml", meta_buf, 0x8000, 0);
-                        if(!status)
+                        //Older packages only have metadata.xml
+                        if(!loadWoomyBinaryMetadata(&woomy_archive))
                         {
-                            OSReport("Install for %s failed, missing metadata.xml\n", to_install);
-                            shiftBackInstallQueue();
-                            continue;
+                            woomy_xml = loadWoomyMetadata(&woomy_archive);
+                            if(!woomy_xml || !compileWoomyEntries(&woomy_archive, woomy_xml))
+                            {
+                                OSReport("Install for %s failed, missing metadata.xml\n", to_install);
+                                freeWoomyMetadata();
+                                mz_zip_reader_end(&woomy_archive);
+                                shiftBackInstallQueue();
+                                continue;
+                            }
                         }
-                        
-                        woomy_xml = ezxml_parse_str(meta_buf, strlen(meta_buf));
-                            
-                        ezxml_t woomy_metadata_name = ezxml_get(woomy_xml, "metadata", 0, "name", -1);
-                        
-                        if(!woomy_metadata_name)
-                            woomy_archive_name = "<no name>";
-                        else
-                            woomy_archive_name = woomy_metadata_name->txt;
                             
                         //Show the icon if it's available
-                        if(!strcmp(ezxml_get(woomy_xml, "metadata", 0, "icon", -1)->txt, "1"))
+                        if(woomy_wants_icon && mz_zip_reader_extract_file_to_mem(&woomy_archive, "icon.tga", icon_mem, 0x10100, 0))
                         {
-                            status = mz_zip_reader_extract_file_to_mem(&woomy_archive, "icon.tga", icon_mem, 0x10100, 0);
-                            if(status)
+                            OSLockMutex(&stateLock);
+                            if(loadTGASurface(&icon_surface, icon_mem, 0x10100))
                                 has_icon = true;
+                            OSUnlockMutex(&stateLock);
                         }
                     }
                     else
@@ -410,28 +735,30 @@ void processInstallQueue(int argc, const char **argv)
                     woomy_processing = true;
                 }
                 
+                OSLockMutex(&stateLock);
                 woomy_extract_prog = 0;
                 woomy_extract_total = 0;
-                ezxml_t entries = ezxml_get(woomy_xml, "entries", 0, "entry", -1);
-                ezxml_t next_entry = ezxml_idx(entries, woomy_install_index++);
-                if(next_entry)
+                OSUnlockMutex(&stateLock);
+                if(woomy_install_index < woomy_num_entries)
                 {
-                    OSReport("Installing woomy entry '%s' from '%s'\n", ezxml_attr(next_entry, "name"), ezxml_attr(next_entry, "folder"));
-                    woomy_entry_name = ezxml_attr(next_entry, "name");
-                    woomy_extract_total = (u32)(strtoul(ezxml_attr(next_entry, "entries"), NULL, 10) & 0xFFFFFFFF);
-                    
-                    if(!woomy_entry_name)
-                        woomy_entry_name = "<no name>";
+                    WoomyEntry *next_entry = &woomy_entries[woomy_install_index++];
+                    OSReport("Installing woomy entry '%s' from '%s' (%u files, %llu bytes)\n", next_entry->name, next_entry->folder, next_entry->numFiles, (unsigned long long)next_entry->uncompTotal);
                     
                     //TODO: tmp to mlc or elsewhere?
                     clear_dir("/vol/external01/tmp/");
                     mkdir("/vol/external01/tmp/", 0x666);
                     
+                    OSLockMutex(&stateLock);
+                    woomy_entry_name = (char*)next_entry->name;
+                    woomy_extract_total = next_entry->count;
                     woomy_extracting = true;
+                    OSUnlockMutex(&stateLock);
                     char *temp_tmp_filename = malloc(0x200);
+                    OSTime extract_start = OSGetTime();
                     
-                    for (int i = 0; i < (int)mz_zip_reader_get_num_files(&woomy_archive); i++)
+                    for (int j = 0; j < next_entry->numFiles; j++)
                     {
+                        int i = woomy_entry_files[next_entry->firstFile + j];
                         mz_zip_archive_file_stat file_stat;
                         if (!mz_zip_reader_file_stat(&woomy_archive, i, &file_stat))
                         {
@@ -439,24 +766,29 @@ void processInstallQueue(int argc, const char **argv)
                             continue;
                         }
 
-                        if (!strncmp(file_stat.m_filename, ezxml_attr(next_entry, "folder"), strlen(ezxml_attr(next_entry, "folder"))) && !mz_zip_reader_is_file_a_directory(&woomy_archive, i))
+                        OSReport("Extracting '%s' (Comment: \"%s\", Method: %u, Uncompressed size: %llu, Compressed size: %llu)\n", file_stat.m_filename, file_stat.m_comment, file_stat.m_method, (unsigned long long)file_stat.m_uncomp_size, (unsigned long long)file_stat.m_comp_size);
+                        
+                        snprintf(temp_tmp_filename, 0x200, "/vol/external01/tmp/%s", file_stat.m_filename + next_entry->folderLen);
+                        OSReport("%s\n", temp_tmp_filename);
+                        if(!extractFile(i, &file_stat, temp_tmp_filename))
+                            OSReport("Failed to extract '%s'\n", file_stat.m_filename);
+                        
+                        //TODO: Maybe use a callback wrapper to show progress?
+                        
+                        char *ext = strchr(file_stat.m_filename, '.');
+                        if(ext && !strcmp(ext, ".app"))
                         {
-                            OSReport("Extracting '%s' (Comment: \"%s\", Uncompressed size: %u, Compressed size: %u)\n", file_stat.m_filename, file_stat.m_comment, (uint)file_stat.m_uncomp_size, (uint)file_stat.m_comp_size);
-                            
-                            snprintf(temp_tmp_filename, 0x200, "/vol/external01/tmp/%s", file_stat.m_filename + strlen(ezxml_attr(next_entry, "folder")));
-                            OSReport("%s\n", temp_tmp_filename);
-                            mz_zip_reader_extract_file_to_file(&woomy_archive, file_stat.m_filename, temp_tmp_filename, 0);
-                            
-                            //TODO: Maybe use a callback wrapper to show progress?
-                            
-                            char *ext = strchr(file_stat.m_filename, '.');
-                            if(ext && !strcmp(ext, ".app"))
-                                woomy_extract_prog++;
+                            OSLockMutex(&stateLock);
+                            woomy_extract_prog++;
+                            OSUnlockMutex(&stateLock);
                         }
                     }
 
                     free(temp_tmp_filename);
                     
+                    //Unpack timings, for comparing deflate and LZ4 packages of the same title
+                    OSReport("Unpacked entry '%s' (%llu bytes from %llu) in %llu ms\n", woomy_entry_name, (unsigned long long)next_entry->uncompTotal, (unsigned long long)next_entry->compTotal, (unsigned long long)OSTicksToMilliseconds(OSGetTime() - extract_start));
+                    
                     to_install = malloc(0x200);
                     snprintf(to_install, 0x200, "/vol/app_sd/tmp/");
                 }
@@ -464,26 +796,33 @@ void processInstallQueue(int argc, const char **argv)
                 {
                     OSReport("Exhausted entries from '%s', advancing install queue.\n", to_install);
                     
-                    mz_zip_reader_end(&woomy_archive);
-                    ezxml_free(woomy_xml);
-                    
+                    //The names point into the metadata, so drop them first
+                    OSLockMutex(&stateLock);
                     woomy_archive_name = NULL;
                     woomy_entry_name = NULL;
+                    woomy_extracting = false;
+                    OSUnlockMutex(&stateLock);
+                    
+                    mz_zip_reader_end(&woomy_archive);
+                    freeWoomyMetadata();
                     
                     //TODO: tmp to mlc or elsewhere?
                     clear_dir("/vol/external01/tmp/");
                     
-                    woomy_extracting = false;
                     woomy_processing = false;
                     shiftBackInstallQueue();
                     continue;
                 }
                 
+                OSLockMutex(&stateLock);
                 woomy_extracting = false;
+                OSUnlockMutex(&stateLock);
             }
             else
             {
+                OSLockMutex(&stateLock);
                 has_icon = false;
+                OSUnlockMutex(&stateLock);
             }
             
             if(installDevices[installQueueTarget[0]].deviceID == MCP_INSTALL_TARGET_USB)
@@ -503,9 +842,11 @@ void processInstallQueue(int argc, const char **argv)
                 {
                     if(MCP_InstallTitleAsync(mcp_thread_handle, to_install, mcp_install_buf) >= 0)
                     {
+                        OSLockMutex(&stateLock);
                         installing = true;
-                        
                         currentlyInstalling = to_install;
+                        OSUnlockMutex(&stateLock);
+                        
                         if(!woomy_processing)
                             shiftBackInstallQueue();
                         
@@ -527,11 +868,258 @@ void processInstallQueue(int argc, const char **argv)
     return 0;
 }
 
+//Everything the screens show, copied out by the main thread and drawn by the
+//render thread. Strings, the queue and the visible directory entries are
+//copied in too, so nothing a snapshot points at changes while it's drawn.
+//Only the queue entries that can fit on screen are kept.
+#define SNAPSHOT_QUEUE_MAX 32
+#define SNAPSHOT_ENTRIES_MAX 32
+
+typedef struct UISnapshot
+{
+    UIState ui;
+    u32 inputCount;
+    u32 iconGeneration;
+    struct dirent *entryPtrs[0x200];
+    struct dirent entries[SNAPSHOT_ENTRIES_MAX+1];
+    char currentDirectory[0x200];
+    char *installQueue[SNAPSHOT_QUEUE_MAX+1];
+    u8 installQueueTarget[SNAPSHOT_QUEUE_MAX+1];
+    char queueNames[SNAPSHOT_QUEUE_MAX][0x200];
+    char currentlyInstalling[0x200];
+    char entryName[0x100];
+    char archiveName[0x100];
+} UISnapshot;
+
+//Three snapshots, one being filled, one being drawn and the latest published
+//one in between. Publishing and picking up only swap indices under the lock,
+//so neither thread ever waits on the other's work.
+UISnapshot snapshots[3];
+int snapshotWrite = 0;
+int snapshotLatest = 1;
+int snapshotRead = 2;
+bool snapshotFresh = false;
+bool snapshotValid = false;
+OSMutex snapshotLock;
+
+OSThread renderThread;
+u8 renderStack[0x10000] __attribute__((aligned(16)));
+Surface render_icon;
+
+//Both screens laid out from the latest snapshot, only touched by the render
+//thread
+UILayout renderLayout;
+
+static void copyString(char *dst, const char *src, size_t size)
+{
+    if(!src)
+        src = "";
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = 0;
+}
+
+void publishUIState(int listLimit, u32 inputCount)
+{
+    UISnapshot *snap = &snapshots[snapshotWrite];
+    UIState *ui = &snap->ui;
+    
+    ui->screenSwap = screenSwap;
+    ui->buttonState = buttonState;
+    ui->listLimit = listLimit;
+    ui->scrollPos = scrollPos;
+    ui->selectedFile = selectedFile;
+    ui->numEntries = numEntries;
+    ui->selectedInstallTarget = selectedInstallTarget;
+    ui->frameStats = showFrameStats ? &frameStats : NULL;
+    snap->inputCount = inputCount;
+    
+    //Only the visible entries and the selected one are drawn
+    int numCopied = 0;
+    memset(snap->entryPtrs, 0, sizeof(snap->entryPtrs));
+    for(int i = 0; i < numEntries; i++)
+    {
+        if(i != selectedFile && (i < scrollPos || i >= scrollPos + listLimit))
+            continue;
+        if(numCopied == SNAPSHOT_ENTRIES_MAX+1)
+            break;
+        memcpy(&snap->entries[numCopied], directoryRead[i], sizeof(struct dirent));
+        snap->entryPtrs[i] = &snap->entries[numCopied++];
+    }
+    ui->entries = snap->entryPtrs;
+    
+    copyString(snap->currentDirectory, currentDirectory, sizeof(snap->currentDirectory));
+    ui->currentDirectory = snap->currentDirectory;
+    
+    //Never changes once the devices are found
+    ui->installDevices = installDevices;
+    
+    ui->installTid = mcp_prog_buf->tid;
+    ui->sizeProgress = mcp_prog_buf->sizeProgress;
+    ui->sizeTotal = mcp_prog_buf->sizeTotal;
+    ui->contentsProgress = mcp_prog_buf->contentsProgress;
+    ui->contentsTotal = mcp_prog_buf->contentsTotal;
+    
+    OSLockMutex(&stateLock);
+    int queued = 0;
+    for(; queued < SNAPSHOT_QUEUE_MAX && installQueue[queued] != NULL; queued++)
+    {
+        copyString(snap->queueNames[queued], installQueue[queued], sizeof(snap->queueNames[queued]));
+        snap->installQueue[queued] = snap->queueNames[queued];
+        snap->installQueueTarget[queued] = installQueueTarget[queued];
+    }
+    snap->installQueue[queued] = NULL;
+    ui->installQueue = snap->installQueue;
+    ui->installQueueTarget = snap->installQueueTarget;
+    
+    ui->installing = installing;
+    copyString(snap->currentlyInstalling, currentlyInstalling, sizeof(snap->currentlyInstalling));
+    ui->currentlyInstalling = snap->currentlyInstalling;
+    
+    ui->extracting = woomy_extracting;
+    if(woomy_extracting)
+    {
+        copyString(snap->entryName, woomy_entry_name, sizeof(snap->entryName));
+        copyString(snap->archiveName, woomy_archive_name, sizeof(snap->archiveName));
+    }
+    ui->entryName = snap->entryName;
+    ui->archiveName = snap->archiveName;
+    ui->extractProg = woomy_extract_prog;
+    ui->extractTotal = woomy_extract_total;
+    
+    ui->hasIcon = has_icon;
+    snap->iconGeneration = icon_surface.generation;
+    OSUnlockMutex(&stateLock);
+    
+    //The render thread keeps its own copy of the icon, see renderMain
+    ui->icon = &render_icon;
+    
+    OSLockMutex(&snapshotLock);
+    int latest = snapshotLatest;
+    snapshotLatest = snapshotWrite;
+    snapshotWrite = latest;
+    snapshotFresh = true;
+    OSUnlockMutex(&snapshotLock);
+}
+
+//Returns the newest published snapshot, which stays put until the next call
+UISnapshot *acquireUIState()
+{
+    OSLockMutex(&snapshotLock);
+    if(snapshotFresh)
+    {
+        int latest = snapshotLatest;
+        snapshotLatest = snapshotRead;
+        snapshotRead = latest;
+        snapshotFresh = false;
+        snapshotValid = true;
+    }
+    OSUnlockMutex(&snapshotLock);
+    
+    return snapshotValid ? &snapshots[snapshotRead] : NULL;
+}
+
+int renderMain(int argc, const char **argv)
+{
+    u32 lastInputCount = 0;
+    u32 iconGeneration = 0;
+#ifdef DRAW_BENCH
+    drawBenchBlend();
+    OSTime benchTotal = 0;
+    int benchFrames = 0;
+    int benchWorkers = 1;
+#endif
+
+    while(isAppRunning)
+    {
+        UISnapshot *snap = acquireUIState();
+        if(!snap)
+        {
+            OSSleepTicks(OSMillisecondsToTicks(1));
+            continue;
+        }
+        
+        UIState *ui = &snap->ui;
+        frameBegin(snap->inputCount != lastInputCount, ui->installing, ui->extracting);
+        lastInputCount = snap->inputCount;
+        
+        //A new icon gets copied over once, so the install thread can load the
+        //next one while this one is still on screen
+        if(ui->hasIcon && snap->iconGeneration != iconGeneration)
+        {
+            OSLockMutex(&stateLock);
+            if(copySurface(&render_icon, &icon_surface))
+                iconGeneration = icon_surface.generation;
+            OSUnlockMutex(&stateLock);
+        }
+        
+        //Tiles only go to the other cores while nothing is queued, the install
+        //thread is busy between entries well before it says it's installing
+        bool busy = ui->installing || ui->extracting || ui->installQueue[0];
+        setDrawWorkers(busy ? 1 : 3);
+        
+        OSLockMutex(&screenLock);
+        if(initialized)
+        {
+#ifdef DRAW_BENCH
+            //Time full repaints, not just what changed
+            OSTime benchStart = OSGetSystemTime();
+            markScreenDirty(SCREEN_TOP);
+            markScreenDirty(SCREEN_BOTTOM);
+            setDrawWorkers(benchWorkers);
+#endif
+            layoutUI(ui, &renderLayout);
+            for(int screen = SCREEN_TOP; screen <= SCREEN_BOTTOM; screen++)
+            {
+                if(!frameDrawScreen(screen))
+                    continue;
+                beginFrame(screen);
+                drawLayout(&renderLayout, screen);
+                endFrame();
+            }
+#ifdef DRAW_BENCH
+            //Every 300 frames move on to the next renderer, the spans on one to
+            //three cores and then OSScreenPutPixelEx
+            benchTotal += OSGetSystemTime() - benchStart;
+            if(++benchFrames == 300)
+            {
+                if(drawSlowPath)
+                    OSReport("OSScreenPutPixelEx: %llu us per frame\n", (unsigned long long)OSTicksToMicroseconds(benchTotal / benchFrames));
+                else
+                    OSReport("spans on %d cores: %llu us per frame\n", benchWorkers, (unsigned long long)OSTicksToMicroseconds(benchTotal / benchFrames));
+                
+                if(drawSlowPath)
+                {
+                    drawSlowPath = false;
+                    benchWorkers = 1;
+                }
+                else if(++benchWorkers > 3)
+                {
+                    drawSlowPath = true;
+                }
+                benchTotal = 0;
+                benchFrames = 0;
+            }
+#endif
+        }
+        OSUnlockMutex(&screenLock);
+        
+        frameEnd();
+    }
+    
+    freeSurface(&render_icon);
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
     OSScreenInit();
     OSReport("Screen initted\n");
     
+    OSInitMutex(&stateLock);
+    OSInitMutex(&snapshotLock);
+    OSInitMutex(&screenLock);
+    OSInitMutex(&crcLock);
+    
     ProcUIInit(&SaveCallback);
     int initret = fsDevInit();
     currentDirectory = malloc(0x200);
@@ -598,16 +1186,29 @@ int main(int argc, char **argv)
     
     numEntries = readDirectory(currentDirectory, directoryRead);
     
+    OSInitSemaphore(&crc_job_sema, 0);
+    OSInitSemaphore(&crc_done_sema, 0);
+    OSCreateThread(&crcThread, crcWorker, 0, NULL, crcStack + sizeof(crcStack), sizeof(crcStack), 16, OS_THREAD_ATTRIB_AFFINITY_CPU0);
+    OSResumeThread(&crcThread);
+    
     OSThread *threadCore2 = OSGetDefaultThread(2);
     OSRunThread(threadCore2, processInstallQueue, 0, NULL);
     
+    //Drawing gets its own thread on the main core, below input so a slow
+    //frame never holds up the next button press
+    OSCreateThread(&renderThread, renderMain, 0, NULL, renderStack + sizeof(renderStack), sizeof(renderStack), 20, OS_THREAD_ATTRIB_AFFINITY_CPU1);
+    OSResumeThread(&renderThread);
+    
     int error;
 	VPADStatus vpad_data;
+    u32 inputCount = 0;
     while(AppRunning())
     {
         if(!initialized) continue;
     
         VPADRead(0, &vpad_data, 1, &error);
+        if(vpad_data.hold || vpad_data.tpNormal.touched)
+            inputCount++;
         
         lastButtonState = buttonState;
         buttonState = false;
@@ -717,16 +1318,15 @@ int main(int argc, char **argv)
         {
             selectedInstallTarget = (selectedInstallTarget + 1) % numInstallDevices;
         }
-    
-        setActiveScreen(screenSwap ? SCREEN_BOTTOM : SCREEN_TOP);
-        fillScreen(0,0,0,0);
-        drawBorder(9, 0xC9, 0x34, 0x57, 0);
-        
-        centerStringf(20,"Woom\xefnstaller");
-        drawString(20, 40, currentDirectory);
-        drawStringf(20, 60, "Current Install Target: \x80\xFF\xAA\xAA%s%02u", installDevices[selectedInstallTarget].deviceName, installDevices[selectedInstallTarget].deviceNum);
+        else if(vpad_data.trigger & VPAD_BUTTON_ZL)
+        {
+            showFrameStats = !showFrameStats;
+        }
         
-        if(installing)
+        OSLockMutex(&stateLock);
+        bool pollProgress = installing;
+        OSUnlockMutex(&stateLock);
+        if(pollProgress)
         {
             int ret = MCP_InstallGetProgress(mcp_handle, mcp_prog_buf);
             
@@ -739,157 +1339,18 @@ int main(int argc, char **argv)
                 mcp_prog_buf->contentsProgress = 17;
                 mcp_prog_buf->contentsTotal = 30;
             }
-            
-            //TODO: Show woomy metadata instead of TID?
-            drawRectThickness(30, 90, getScreenWidth() - 30, 260+(has_icon?110:0), 2, 255,255,255,0);
-            
-            if(!screenSwap)
-                drawStringf(42, 100, "Installing \x80\xFF\xAA\xAA%016llX\x80\xFF\xFF\xFF from \x80\xFF\xAA\xAA%s", mcp_prog_buf->tid, currentlyInstalling);
-            else
-                drawStringf(42, 100, "Installing \x80\xFF\xAA\xAA%016llX", mcp_prog_buf->tid);
-                
-            drawStringf(42, 120, "%llu of %llu bytes written", mcp_prog_buf->sizeProgress, mcp_prog_buf->sizeTotal);
-            drawStringf(42, 140, "Installing content %u out of %u", mcp_prog_buf->contentsProgress, mcp_prog_buf->contentsTotal);
-            
-            drawRectThickness(40, 170+(has_icon?110:0), getScreenWidth() - 40, 205+(has_icon?110:0), 2, 128,128,128,0);
-            if(mcp_prog_buf->sizeProgress > 0)
-            {
-                float installPercent = ((float)mcp_prog_buf->sizeProgress / (float)mcp_prog_buf->sizeTotal)*100.0f;
-                float installPartPercent = ((float)mcp_prog_buf->sizeProgress / (float)mcp_prog_buf->sizeTotal);
-                drawFillRect(40+4, 170+4+(has_icon?110:0), MAX(40+4, ((getScreenWidth() - 40)-4)*installPartPercent), 205-4+(has_icon?110:0), 255, 170, 170, 0);
-                centerStringf(215+(has_icon?110:0), "%5.1f%% complete", installPercent);
-            }
-            
-            if(has_icon)
-            {
-                drawTGA(getScreenWidth() - 60 - 128, 130, icon_mem);
-            }
-        }
-        else if(woomy_extracting)
-        {
-            drawRectThickness(30, 90, getScreenWidth() - 30, 260+(has_icon?110:0), 2, 255,255,255,0);
-            
-            if(!screenSwap)
-                drawStringf(42, 100,                        "Preparing to install \x80\xFF\xAA\xAA%s\x80\xFF\xFF\xFF from \x80\xFF\xAA\xAA%s\x80\xFF\xFF\xFF", woomy_entry_name, woomy_archive_name);
-            else
-                drawStringf(42, 100,                        "Preparing to install \x80\xFF\xAA\xAA%s\x80\xFF\xFF\xFF", woomy_entry_name);
-                
-            drawStringf(42, 120, "Unpacking contents %u of %u", woomy_extract_prog, woomy_extract_total);
-            drawRectThickness(40, 170+(has_icon?110:0), getScreenWidth() - 40, 205+(has_icon?110:0), 2, 128,128,128,0);
-            //TODO: Maybe show extraction progress?
-            /*if(mcp_prog_buf->sizeProgress > 0)
-            {
-                float installPercent = ((float)mcp_prog_buf->sizeProgress / (float)mcp_prog_buf->sizeTotal)*100.0f;
-                float installPartPercent = ((float)mcp_prog_buf->sizeProgress / (float)mcp_prog_buf->sizeTotal);
-                drawFillRect(40+4, 150+4+(has_icon?110:0), MAX(40+4, ((getScreenWidth() - 40)-4)*installPartPercent), 185-4+(has_icon?110:0), 255, 170, 170, 0);
-                centerStringf(195+(has_icon?110:0), "%5.1f%% complete", installPercent);
-            }*/
-            
-            if(has_icon)
-            {
-                drawTGA(getScreenWidth() - 60 - 128, 130, icon_mem);
-            }
-        }
-        else
-        {   
-            if(directoryRead[selectedFile]->d_type == DT_DIR)
-                drawStringfColor(20,100,255,170,170,0," %s/", directoryRead[selectedFile]->d_name);
-            else
-                drawStringfColor(20,100,255,170,170,0," %s", directoryRead[selectedFile]->d_name);
         }
         
-        if(installQueue[0] != NULL)
-        {
-            int yPos = 300+(has_icon?110:0);
-            int yLimit = screenSwap ? getScreenHeight()-40 : getScreenHeight()-100;
-            drawStringf(20, yPos, "Current install queue:");
-            for(int i = 0; i < INSTALL_QUEUE_SIZE; i++)
-            {
-                if(installQueue[i] == NULL)
-                    break;
-                
-                yPos += 20;
-                drawStringfColor(30,yPos,255,170,170,0, (yPos >= yLimit && installQueue[i+1] != NULL) ? "%s" : "%-41s -> %s%02u",(yPos >= yLimit && installQueue[i+1] != NULL) ? "..." : installQueue[i], installDevices[installQueueTarget[i]].deviceName, installDevices[installQueueTarget[i]].deviceNum);
-                if(yPos >= yLimit)
-                    break;
-            }
-        }
-        
-        //Control usage
-        if(!screenSwap)
-        {
-            drawStringf(20,getScreenHeight()-50,                    "A:                     B:              Y:                   X: ");
-            drawStringfColor(20,getScreenHeight()-50,255,170,170,0, "                          Exit Folder     Add FST to queue     Cancel Install");
-            drawStringfColor(20,getScreenHeight()-60,255,170,170,0, "   Enter Folder");
-            drawStringfColor(20,getScreenHeight()-40,255,170,170,0, "   Add Woomy to queue");
-        }
-        
-        //Swap screen button
-        if(screenSwap)
-        {
-            VPADTouchData tpCalib;
-            VPADGetTPCalibratedPoint(0, &tpCalib, &vpad_data.tpNormal);
-            int tpxpos = (int)(((float)tpCalib.x / 1280.0f) * (float)getScreenWidth());
-			int tpypos = (int)(((float)tpCalib.y / 720.0f) * (float)getScreenHeight());
-
-            if(vpad_data.tpNormal.touched && tpxpos > getScreenWidth()-160 && tpxpos < getScreenWidth() - 20 && tpypos > 20 && tpypos < 80)
-                buttonState = true;
-        
-            u8 color = buttonState ? 60 : 20;
-            drawFillRect(getScreenWidth()-160, 20, getScreenWidth() - 20, 80, color,color,color,0);
-            drawRectThickness(getScreenWidth()-160, 20, getScreenWidth() - 20, 80, 2, 128,128,128,0);
-            drawStringf(getScreenWidth()-140, 30," Swap");
-            drawStringf(getScreenWidth()-160, 50," Screens");
-        }
-        
-        flipBuffers();
-        
-        setActiveScreen(screenSwap ? SCREEN_TOP : SCREEN_BOTTOM);
-        fillScreen(0,0,0,0);
-        drawBorder(9, 4, 0x81, 0x88, 0);
-        
-        int ypos = 20;
-        for(int i = scrollPos; i < MIN(scrollPos+listLimit, numEntries); i++)
-        {
-            if(directoryRead[i] == NULL)
-                continue;
-        
-            char buf[256];
-            drawStringfColor(20, ypos, 0, 255, 255, 0, " %s", selectedFile == i ? ">" : " ");
-            if(directoryRead[i]->d_type == DT_DIR)
-                drawStringfColor(20, ypos, 255, 255, 255, 0, "   %s/", directoryRead[i]->d_name);
-            else
-                drawStringfColor(20, ypos, 150, 255, 255, 0, "   %s", directoryRead[i]->d_name);
-            
-            ypos += 20;
-        }
-        
-        //Swap screen button
-        if(!screenSwap)
-        {
-            VPADTouchData tpCalib;
-            VPADGetTPCalibratedPoint(0, &tpCalib, &vpad_data.tpNormal);
-            int tpxpos = (int)(((float)tpCalib.x / 1280.0f) * (float)getScreenWidth());
-			int tpypos = (int)(((float)tpCalib.y / 720.0f) * (float)getScreenHeight());
+        //Swap screen button, always on the gamepad
+        VPADTouchData tpCalib;
+        VPADGetTPCalibratedPoint(0, &tpCalib, &vpad_data.tpNormal);
+        int tpxpos = (int)(((float)tpCalib.x / 1280.0f) * (float)DRC_WIDTH);
+        int tpypos = (int)(((float)tpCalib.y / 720.0f) * (float)DRC_HEIGHT);
 
-            if(vpad_data.tpNormal.touched && tpxpos > getScreenWidth()-160 && tpxpos < getScreenWidth() - 20 && tpypos > 20 && tpypos < 80)
-                buttonState = true;
+        if(vpad_data.tpNormal.touched && tpxpos > DRC_WIDTH-160 && tpxpos < DRC_WIDTH - 20 && tpypos > 20 && tpypos < 80)
+            buttonState = true;
         
-            u8 color = buttonState ? 60 : 20;
-            drawFillRect(getScreenWidth()-160, 20, getScreenWidth() - 20, 80, color,color,color,0);
-            drawRectThickness(getScreenWidth()-160, 20, getScreenWidth() - 20, 80, 2, 128,128,128,0);
-            drawStringf(getScreenWidth()-140, 30," Swap");
-            drawStringf(getScreenWidth()-160, 50," Screens");
-        }
-        
-        //Control usage
-        if(screenSwap)
-        {
-            drawStringf(20,getScreenHeight()-50,                    "A:                     B:              Y:                   X: ");
-            drawStringfColor(20,getScreenHeight()-50,150, 255, 255, 0, "                          Exit Folder     Add FST to queue     Cancel Install");
-            drawStringfColor(20,getScreenHeight()-60,150, 255, 255, 0, "   Enter Folder");
-            drawStringfColor(20,getScreenHeight()-40,150, 255, 255, 0, "   Add Woomy to queue");
-        }
+        publishUIState(listLimit, inputCount);
         
         if(buttonState != lastButtonState && !lastButtonState)
         {
@@ -897,10 +1358,18 @@ int main(int argc, char **argv)
             listLimit = screenSwap ? 31 : 22;
             scrollPos = MIN(numEntries < listLimit ? 0 : numEntries - listLimit, selectedFile);
         }
-    
-        flipBuffers();
+        
+        //Input is polled at the fastest frame rate, the render thread
+        //decides how often the screens actually change
+        OSSleepTicks(OSSecondsToTicks(1) / FRAME_RATE_FAST);
     }
     
+    OSLockMutex(&crcLock);
+    crc_worker_running = false;
+    OSSignalSemaphore(&crc_job_sema);
+    OSUnlockMutex(&crcLock);
+    OSJoinThread(&crcThread, NULL);
+    OSJoinThread(&renderThread, NULL);
     free(mcp_prog_buf);
     free(installQueue);
     free(installQueueTarget);
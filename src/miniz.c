@@ -140,7 +140,7 @@
      possibility that the archive's central directory could be lost with this method if anything goes wrong, though.
 
      - ZIP archive support limitations:
-     No zip64 or spanning support. Extraction functions can only handle unencrypted, stored or deflated files.
+     Zip64 archives are supported, spanning is not. Extraction functions can only handle unencrypted, stored or deflated files.
      Requires streams capable of seeking.
 
    * This is a header file library, like stb_image.c. To get only a header file, either cut and paste the
@@ -156,6 +156,19 @@
      (i.e. 32-bit stat() fails for me on files > 0x7FFFFFFF bytes).
 */
 
+// Define MINIZ_LINUX_COPY_FILE_RANGE to let mz_zip_reader_extract_to_file() copy stored entries inside the kernel on Linux. It needs _GNU_SOURCE
+// and linking with -pthread, so it's off by default.
+#if defined(MINIZ_LINUX_COPY_FILE_RANGE) && defined(__linux__) && !defined(MINIZ_NO_STDIO) && !defined(MINIZ_NO_ARCHIVE_APIS)
+  #define MINIZ_USE_COPY_FILE_RANGE 1
+#endif
+
+// The stdio archive functions need fseeko()/ftello() to address zip64 archives past the 2GB mark.
+#if defined(MINIZ_USE_COPY_FILE_RANGE) && !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE
+#elif !defined(_POSIX_C_SOURCE) && !defined(_MSC_VER)
+  #define _POSIX_C_SOURCE 200112L
+#endif
+
 #include "miniz.h"
 
 typedef unsigned char mz_validate_uint16[sizeof(mz_uint16)==2 ? 1 : -1];
@@ -165,6 +178,18 @@ typedef unsigned char mz_validate_uint64[sizeof(mz_uint64)==8 ? 1 : -1];
 #include <string.h>
 #include <assert.h>
 
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(MINIZ_NO_STDIO) && !defined(MINIZ_NO_ARCHIVE_APIS)
+  // Positional reads let several threads share one archive file.
+  #define MINIZ_HAS_PREAD 1
+  #include <unistd.h>
+#endif
+
+#ifdef MINIZ_USE_COPY_FILE_RANGE
+  #include <errno.h>
+  #include <pthread.h>
+  #include <sys/sendfile.h>
+#endif
+
 #define MZ_ASSERT(x) assert(x)
 
 #ifdef MINIZ_NO_MALLOC
@@ -2067,6 +2092,143 @@ void *tdefl_write_image_to_png_file_in_memory(const void *pImage, int w, int h,
 #pragma warning (pop)
 #endif
 
+// ------------------- LZ4 block codec
+
+// Matches are at least 4 bytes, the last 5 bytes of a block are always literals and the last match has to start 12 bytes before the end of the block.
+enum { MZ_LZ4_MIN_MATCH = 4, MZ_LZ4_LAST_LITERALS = 5, MZ_LZ4_MF_LIMIT = 12 };
+
+static MZ_FORCEINLINE mz_uint32 mz_lz4_read_u32(const mz_uint8 *p) { mz_uint32 v; memcpy(&v, p, sizeof(v)); return v; }
+
+static MZ_FORCEINLINE mz_uint mz_lz4_hash(mz_uint32 seq) { return (mz_uint)((seq * 2654435761U) >> (32 - MZ_LZ4_HASH_BITS)); }
+
+// Writes a literal or match length, the first 15 of which went into the token's nibble.
+static mz_uint8 *mz_lz4_put_length(mz_uint8 *pOut, size_t len)
+{
+  for ( ; len >= 255; len -= 255)
+    *pOut++ = 255;
+  *pOut++ = (mz_uint8)len;
+  return pOut;
+}
+
+// Writes a sequence's token, literals and (if match_len is non-zero) match. Returns NULL if the sequence doesn't fit.
+static mz_uint8 *mz_lz4_put_sequence(mz_uint8 *pOut, mz_uint8 *pOut_end, const mz_uint8 *pLiterals, size_t lit_len, mz_uint dist, size_t match_len)
+{
+  mz_uint8 *pToken = pOut;
+  if ((size_t)(pOut_end - pOut) < (1 + lit_len / 255 + 1 + lit_len + 2 + match_len / 255 + 1))
+    return NULL;
+  *pOut++ = 0;
+  if (lit_len >= 15) { *pToken = 15 << 4; pOut = mz_lz4_put_length(pOut, lit_len - 15); } else *pToken = (mz_uint8)(lit_len << 4);
+  memcpy(pOut, pLiterals, lit_len); pOut += lit_len;
+  if (!match_len)
+    return pOut;
+  *pOut++ = (mz_uint8)dist; *pOut++ = (mz_uint8)(dist >> 8);
+  match_len -= MZ_LZ4_MIN_MATCH;
+  if (match_len >= 15) { *pToken |= 15; pOut = mz_lz4_put_length(pOut, match_len - 15); } else *pToken |= (mz_uint8)match_len;
+  return pOut;
+}
+
+size_t mz_lz4_compress_block(const void *pSrc, size_t src_len, void *pDst, size_t dst_len, mz_uint16 *pHash_table)
+{
+  const mz_uint8 *pIn = (const mz_uint8 *)pSrc, *pAnchor = pIn, *pCur = pIn;
+  mz_uint8 *pOut = (mz_uint8 *)pDst, *pOut_end = pOut + dst_len;
+
+  if (src_len > MZ_LZ4_BLOCK_SIZE)
+    return 0;
+
+  if (src_len > MZ_LZ4_MF_LIMIT)
+  {
+    const mz_uint8 *pSearch_end = pIn + src_len - MZ_LZ4_MF_LIMIT, *pMatch_limit = pIn + src_len - MZ_LZ4_LAST_LITERALS;
+    mz_uint misses = 0;
+    memset(pHash_table, 0, sizeof(mz_uint16) * MZ_LZ4_HASH_SIZE);
+    while (pCur <= pSearch_end)
+    {
+      mz_uint32 seq = mz_lz4_read_u32(pCur);
+      mz_uint h = mz_lz4_hash(seq);
+      const mz_uint8 *pRef = pIn + pHash_table[h], *pMatch_end;
+      mz_uint dist;
+      pHash_table[h] = (mz_uint16)(pCur - pIn);
+      if ((pRef >= pCur) || (mz_lz4_read_u32(pRef) != seq))
+      {
+        // Skip ahead faster through data that isn't matching.
+        pCur += 1 + (misses++ >> 6);
+        continue;
+      }
+      misses = 0;
+      dist = (mz_uint)(pCur - pRef);
+
+      for (pMatch_end = pCur + MZ_LZ4_MIN_MATCH, pRef += MZ_LZ4_MIN_MATCH; (pMatch_end < pMatch_limit) && (*pMatch_end == *pRef); ++pMatch_end, ++pRef) { }
+
+      if (NULL == (pOut = mz_lz4_put_sequence(pOut, pOut_end, pAnchor, pCur - pAnchor, dist, pMatch_end - pCur)))
+        return 0;
+      pCur = pAnchor = pMatch_end;
+    }
+  }
+
+  // The last sequence only carries literals.
+  if (NULL == (pOut = mz_lz4_put_sequence(pOut, pOut_end, pAnchor, pIn + src_len - pAnchor, 0, 0)))
+    return 0;
+  return pOut - (mz_uint8 *)pDst;
+}
+
+int mz_lz4_decompress_block(const void *pSrc, size_t src_len, void *pDst, size_t dst_len)
+{
+  const mz_uint8 *pIn = (const mz_uint8 *)pSrc, *pIn_end = pIn + src_len;
+  mz_uint8 *pOut = (mz_uint8 *)pDst, *pOut_end = pOut + dst_len;
+
+  for ( ; ; )
+  {
+    size_t len, dist;
+    mz_uint token;
+    const mz_uint8 *pRef;
+
+    if (pIn >= pIn_end)
+      return -1;
+    token = *pIn++;
+
+    // Literals
+    if ((len = token >> 4) == 15)
+    {
+      mz_uint8 b;
+      do { if (pIn >= pIn_end) return -1; b = *pIn++; len += b; } while (b == 255);
+    }
+    if ((len > (size_t)(pIn_end - pIn)) || (len > (size_t)(pOut_end - pOut)))
+      return -1;
+    memcpy(pOut, pIn, len); pOut += len; pIn += len;
+    if (pIn == pIn_end)
+      break;
+
+    // Match
+    if ((pIn_end - pIn) < 2)
+      return -1;
+    dist = pIn[0] | (pIn[1] << 8); pIn += 2;
+    if ((!dist) || (dist > (size_t)(pOut - (mz_uint8 *)pDst)))
+      return -1;
+    if ((len = token & 15) == 15)
+    {
+      mz_uint8 b;
+      do { if (pIn >= pIn_end) return -1; b = *pIn++; len += b; } while (b == 255);
+    }
+    len += MZ_LZ4_MIN_MATCH;
+    if (len > (size_t)(pOut_end - pOut))
+      return -1;
+
+    pRef = pOut - dist;
+    if (dist == 1)
+    {
+      memset(pOut, *pRef, len); pOut += len;
+    }
+    else
+    {
+      // Overlapping matches repeat the last dist bytes, so copy them a period at a time.
+      for ( ; len > dist; len -= dist, pOut += dist)
+        memcpy(pOut, pRef, dist);
+      memcpy(pOut, pRef, len); pOut += len;
+    }
+  }
+
+  return (int)(pOut - (mz_uint8 *)pDst);
+}
+
 // ------------------- .ZIP archive reading
 
 #ifndef MINIZ_NO_ARCHIVE_APIS
@@ -2131,8 +2293,8 @@ void *tdefl_write_image_to_png_file_in_memory(const void *pImage, int w, int h,
     #define MZ_FCLOSE fclose
     #define MZ_FREAD fread
     #define MZ_FWRITE fwrite
-    #define MZ_FTELL64 ftell
-    #define MZ_FSEEK64 fseek
+    #define MZ_FTELL64 ftello
+    #define MZ_FSEEK64 fseeko
     #define MZ_FILE_STAT_STRUCT stat
     #define MZ_FILE_STAT stat
     #define MZ_FFLUSH fflush
@@ -2193,8 +2355,25 @@ enum
   // End of central directory offsets
   MZ_ZIP_ECDH_SIG_OFS = 0, MZ_ZIP_ECDH_NUM_THIS_DISK_OFS = 4, MZ_ZIP_ECDH_NUM_DISK_CDIR_OFS = 6, MZ_ZIP_ECDH_CDIR_NUM_ENTRIES_ON_DISK_OFS = 8,
   MZ_ZIP_ECDH_CDIR_TOTAL_ENTRIES_OFS = 10, MZ_ZIP_ECDH_CDIR_SIZE_OFS = 12, MZ_ZIP_ECDH_CDIR_OFS_OFS = 16, MZ_ZIP_ECDH_COMMENT_SIZE_OFS = 20,
+  // Zip64 identifiers and record sizes
+  MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIG = 0x06064b50, MZ_ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIG = 0x07064b50, MZ_ZIP_DATA_DESCRIPTOR_ID = 0x08074b50,
+  MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIZE = 56, MZ_ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE = 20, MZ_ZIP64_EXTENDED_INFORMATION_FIELD_HEADER_ID = 0x0001,
+  MZ_ZIP64_LOCAL_EXTRA_FIELD_SIZE = 4 + 8 + 8, MZ_ZIP64_MAX_CENTRAL_EXTRA_FIELD_SIZE = 4 + 8 + 8 + 8,
+  MZ_ZIP_DATA_DESCRIPTOR_SIZE32 = 16, MZ_ZIP_DATA_DESCRIPTOR_SIZE64 = 24,
+  // Zip64 end of central directory offsets
+  MZ_ZIP64_ECDH_SIG_OFS = 0, MZ_ZIP64_ECDH_SIZE_OF_RECORD_OFS = 4, MZ_ZIP64_ECDH_VERSION_MADE_BY_OFS = 12, MZ_ZIP64_ECDH_VERSION_NEEDED_OFS = 14,
+  MZ_ZIP64_ECDH_NUM_THIS_DISK_OFS = 16, MZ_ZIP64_ECDH_NUM_DISK_CDIR_OFS = 20, MZ_ZIP64_ECDH_CDIR_NUM_ENTRIES_ON_DISK_OFS = 24,
+  MZ_ZIP64_ECDH_CDIR_TOTAL_ENTRIES_OFS = 32, MZ_ZIP64_ECDH_CDIR_SIZE_OFS = 40, MZ_ZIP64_ECDH_CDIR_OFS_OFS = 48,
+  // Zip64 end of central directory locator offsets
+  MZ_ZIP64_ECDL_SIG_OFS = 0, MZ_ZIP64_ECDL_NUM_DISK_CDIR_OFS = 4, MZ_ZIP64_ECDL_REL_OFS_TO_ZIP64_ECDR_OFS = 8, MZ_ZIP64_ECDL_TOTAL_NUMBER_OF_DISKS_OFS = 16,
 };
 
+// Classic zip header fields saturate at these values, the real value then lives in a zip64 record or extra field.
+#define MZ_ZIP32_MAX_FIELD_VALUE 0xFFFFFFFFU
+#define MZ_ZIP16_MAX_FIELD_VALUE 0xFFFFU
+
+#define MZ_READ_LE64(p) ((mz_uint64)MZ_READ_LE32(p) | ((mz_uint64)MZ_READ_LE32((const mz_uint8 *)(p) + sizeof(mz_uint32)) << 32U))
+
 typedef struct
 {
   void *m_p;
@@ -2394,10 +2573,65 @@ static void mz_zip_reader_sort_central_dir_offsets_by_filename(mz_zip_archive *p
   }
 }
 
+// Fetches the sizes and local header offset of a central directory record. Any field saturated at 0xFFFFFFFF is taken from the record's zip64 extended information extra field,
+// which only holds the saturated fields, in the order uncompressed size, compressed size, local header offset.
+static mz_bool mz_zip_reader_get_cdh_sizes(const mz_uint8 *pCentral_header, mz_uint64 *pComp_size, mz_uint64 *pUncomp_size, mz_uint64 *pLocal_header_ofs)
+{
+  const mz_uint8 *pExtra;
+  mz_uint extra_size_remaining;
+  mz_uint64 comp_size = MZ_READ_LE32(pCentral_header + MZ_ZIP_CDH_COMPRESSED_SIZE_OFS);
+  mz_uint64 uncomp_size = MZ_READ_LE32(pCentral_header + MZ_ZIP_CDH_DECOMPRESSED_SIZE_OFS);
+  mz_uint64 local_header_ofs = MZ_READ_LE32(pCentral_header + MZ_ZIP_CDH_LOCAL_HEADER_OFS);
+
+  if ((comp_size == MZ_ZIP32_MAX_FIELD_VALUE) || (uncomp_size == MZ_ZIP32_MAX_FIELD_VALUE) || (local_header_ofs == MZ_ZIP32_MAX_FIELD_VALUE))
+  {
+    mz_bool found = MZ_FALSE;
+    pExtra = pCentral_header + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + MZ_READ_LE16(pCentral_header + MZ_ZIP_CDH_FILENAME_LEN_OFS);
+    extra_size_remaining = MZ_READ_LE16(pCentral_header + MZ_ZIP_CDH_EXTRA_LEN_OFS);
+    while (extra_size_remaining >= sizeof(mz_uint16) * 2)
+    {
+      mz_uint field_id = MZ_READ_LE16(pExtra), field_data_size = MZ_READ_LE16(pExtra + sizeof(mz_uint16));
+      const mz_uint8 *pField_data = pExtra + sizeof(mz_uint16) * 2;
+      if ((field_data_size + sizeof(mz_uint16) * 2) > extra_size_remaining)
+        return MZ_FALSE;
+      if (field_id == MZ_ZIP64_EXTENDED_INFORMATION_FIELD_HEADER_ID)
+      {
+        if (uncomp_size == MZ_ZIP32_MAX_FIELD_VALUE)
+        {
+          if (field_data_size < sizeof(mz_uint64)) return MZ_FALSE;
+          uncomp_size = MZ_READ_LE64(pField_data); pField_data += sizeof(mz_uint64); field_data_size -= sizeof(mz_uint64);
+        }
+        if (comp_size == MZ_ZIP32_MAX_FIELD_VALUE)
+        {
+          if (field_data_size < sizeof(mz_uint64)) return MZ_FALSE;
+          comp_size = MZ_READ_LE64(pField_data); pField_data += sizeof(mz_uint64); field_data_size -= sizeof(mz_uint64);
+        }
+        if (local_header_ofs == MZ_ZIP32_MAX_FIELD_VALUE)
+        {
+          if (field_data_size < sizeof(mz_uint64)) return MZ_FALSE;
+          local_header_ofs = MZ_READ_LE64(pField_data);
+        }
+        found = MZ_TRUE;
+        break;
+      }
+      pExtra += sizeof(mz_uint16) * 2 + field_data_size;
+      extra_size_remaining -= sizeof(mz_uint16) * 2 + field_data_size;
+    }
+    // Saturated fields must be backed by a zip64 extended information field.
+    if (!found)
+      return MZ_FALSE;
+  }
+
+  if (pComp_size) *pComp_size = comp_size;
+  if (pUncomp_size) *pUncomp_size = uncomp_size;
+  if (pLocal_header_ofs) *pLocal_header_ofs = local_header_ofs;
+  return MZ_TRUE;
+}
+
 static mz_bool mz_zip_reader_read_central_dir(mz_zip_archive *pZip, mz_uint32 flags)
 {
-  mz_uint cdir_size, num_this_disk, cdir_disk_index;
-  mz_uint64 cdir_ofs;
+  mz_uint num_this_disk, cdir_disk_index;
+  mz_uint64 cdir_ofs, cdir_size, total_files;
   mz_int64 cur_file_ofs;
   const mz_uint8 *p;
   mz_uint32 buf_u32[4096 / sizeof(mz_uint32)]; mz_uint8 *pBuf = (mz_uint8 *)buf_u32;
@@ -2428,19 +2662,49 @@ static mz_bool mz_zip_reader_read_central_dir(mz_zip_archive *pZip, mz_uint32 fl
   if (pZip->m_pRead(pZip->m_pIO_opaque, cur_file_ofs, pBuf, MZ_ZIP_END_OF_CENTRAL_DIR_HEADER_SIZE) != MZ_ZIP_END_OF_CENTRAL_DIR_HEADER_SIZE)
     return MZ_FALSE;
   if ((MZ_READ_LE32(pBuf + MZ_ZIP_ECDH_SIG_OFS) != MZ_ZIP_END_OF_CENTRAL_DIR_HEADER_SIG) ||
-      ((pZip->m_total_files = MZ_READ_LE16(pBuf + MZ_ZIP_ECDH_CDIR_TOTAL_ENTRIES_OFS)) != MZ_READ_LE16(pBuf + MZ_ZIP_ECDH_CDIR_NUM_ENTRIES_ON_DISK_OFS)))
+      ((total_files = MZ_READ_LE16(pBuf + MZ_ZIP_ECDH_CDIR_TOTAL_ENTRIES_OFS)) != MZ_READ_LE16(pBuf + MZ_ZIP_ECDH_CDIR_NUM_ENTRIES_ON_DISK_OFS)))
     return MZ_FALSE;
 
   num_this_disk = MZ_READ_LE16(pBuf + MZ_ZIP_ECDH_NUM_THIS_DISK_OFS);
   cdir_disk_index = MZ_READ_LE16(pBuf + MZ_ZIP_ECDH_NUM_DISK_CDIR_OFS);
+  cdir_size = MZ_READ_LE32(pBuf + MZ_ZIP_ECDH_CDIR_SIZE_OFS);
+  cdir_ofs = MZ_READ_LE32(pBuf + MZ_ZIP_ECDH_CDIR_OFS_OFS);
+
+  // A zip64 end of central directory locator sits directly in front of the classic record. When present, the zip64 record it points at is authoritative.
+  if (cur_file_ofs >= (MZ_ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE + MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIZE))
+  {
+    mz_uint32 zip64_u32[(MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIZE + sizeof(mz_uint32) - 1) / sizeof(mz_uint32)]; mz_uint8 *pZip64 = (mz_uint8 *)zip64_u32;
+    if (pZip->m_pRead(pZip->m_pIO_opaque, cur_file_ofs - MZ_ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE, pZip64, MZ_ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE) != MZ_ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE)
+      return MZ_FALSE;
+    if (MZ_READ_LE32(pZip64 + MZ_ZIP64_ECDL_SIG_OFS) == MZ_ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIG)
+    {
+      mz_uint64 zip64_cdir_end_ofs = MZ_READ_LE64(pZip64 + MZ_ZIP64_ECDL_REL_OFS_TO_ZIP64_ECDR_OFS);
+      if (zip64_cdir_end_ofs > (pZip->m_archive_size - MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIZE))
+        return MZ_FALSE;
+      if (pZip->m_pRead(pZip->m_pIO_opaque, zip64_cdir_end_ofs, pZip64, MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIZE) != MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIZE)
+        return MZ_FALSE;
+      if ((MZ_READ_LE32(pZip64 + MZ_ZIP64_ECDH_SIG_OFS) != MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIG) ||
+          ((total_files = MZ_READ_LE64(pZip64 + MZ_ZIP64_ECDH_CDIR_TOTAL_ENTRIES_OFS)) != MZ_READ_LE64(pZip64 + MZ_ZIP64_ECDH_CDIR_NUM_ENTRIES_ON_DISK_OFS)))
+        return MZ_FALSE;
+      num_this_disk = MZ_READ_LE32(pZip64 + MZ_ZIP64_ECDH_NUM_THIS_DISK_OFS);
+      cdir_disk_index = MZ_READ_LE32(pZip64 + MZ_ZIP64_ECDH_NUM_DISK_CDIR_OFS);
+      cdir_size = MZ_READ_LE64(pZip64 + MZ_ZIP64_ECDH_CDIR_SIZE_OFS);
+      cdir_ofs = MZ_READ_LE64(pZip64 + MZ_ZIP64_ECDH_CDIR_OFS_OFS);
+    }
+  }
+
   if (((num_this_disk | cdir_disk_index) != 0) && ((num_this_disk != 1) || (cdir_disk_index != 1)))
     return MZ_FALSE;
 
-  if ((cdir_size = MZ_READ_LE32(pBuf + MZ_ZIP_ECDH_CDIR_SIZE_OFS)) < pZip->m_total_files * MZ_ZIP_CENTRAL_DIR_HEADER_SIZE)
+  // The central directory is held in memory and indexed with 32-bit offsets.
+  if ((total_files > MZ_ZIP32_MAX_FIELD_VALUE) || (cdir_size > MZ_ZIP32_MAX_FIELD_VALUE))
     return MZ_FALSE;
+  pZip->m_total_files = (mz_uint)total_files;
 
-  cdir_ofs = MZ_READ_LE32(pBuf + MZ_ZIP_ECDH_CDIR_OFS_OFS);
-  if ((cdir_ofs + (mz_uint64)cdir_size) > pZip->m_archive_size)
+  if (cdir_size < total_files * MZ_ZIP_CENTRAL_DIR_HEADER_SIZE)
+    return MZ_FALSE;
+
+  if ((cdir_ofs + cdir_size) > pZip->m_archive_size)
     return MZ_FALSE;
 
   pZip->m_central_directory_file_ofs = cdir_ofs;
@@ -2450,7 +2714,7 @@ static mz_bool mz_zip_reader_read_central_dir(mz_zip_archive *pZip, mz_uint32 fl
      mz_uint i, n;
 
     // Read the entire central directory into a heap block, and allocate another heap block to hold the unsorted central dir file record offsets, and another to hold the sorted indices.
-    if ((!mz_zip_array_resize(pZip, &pZip->m_pState->m_central_dir, cdir_size, MZ_FALSE)) ||
+    if ((!mz_zip_array_resize(pZip, &pZip->m_pState->m_central_dir, (size_t)cdir_size, MZ_FALSE)) ||
         (!mz_zip_array_resize(pZip, &pZip->m_pState->m_central_dir_offsets, pZip->m_total_files, MZ_FALSE)))
       return MZ_FALSE;
 
@@ -2460,29 +2724,30 @@ static mz_bool mz_zip_reader_read_central_dir(mz_zip_archive *pZip, mz_uint32 fl
         return MZ_FALSE;
     }
 
-    if (pZip->m_pRead(pZip->m_pIO_opaque, cdir_ofs, pZip->m_pState->m_central_dir.m_p, cdir_size) != cdir_size)
+    if (pZip->m_pRead(pZip->m_pIO_opaque, cdir_ofs, pZip->m_pState->m_central_dir.m_p, (size_t)cdir_size) != cdir_size)
       return MZ_FALSE;
 
-    // Now create an index into the central directory file records, do some basic sanity checking on each record, and check for zip64 entries (which are not yet supported).
+    // Now create an index into the central directory file records, and do some basic sanity checking on each record (including any zip64 extended information).
     p = (const mz_uint8 *)pZip->m_pState->m_central_dir.m_p;
-    for (n = cdir_size, i = 0; i < pZip->m_total_files; ++i)
+    for (n = (mz_uint)cdir_size, i = 0; i < pZip->m_total_files; ++i)
     {
-      mz_uint total_header_size, comp_size, decomp_size, disk_index;
+      mz_uint total_header_size, disk_index;
+      mz_uint64 comp_size, decomp_size, local_header_ofs;
       if ((n < MZ_ZIP_CENTRAL_DIR_HEADER_SIZE) || (MZ_READ_LE32(p) != MZ_ZIP_CENTRAL_DIR_HEADER_SIG))
         return MZ_FALSE;
       MZ_ZIP_ARRAY_ELEMENT(&pZip->m_pState->m_central_dir_offsets, mz_uint32, i) = (mz_uint32)(p - (const mz_uint8 *)pZip->m_pState->m_central_dir.m_p);
       if (sort_central_dir)
         MZ_ZIP_ARRAY_ELEMENT(&pZip->m_pState->m_sorted_central_dir_offsets, mz_uint32, i) = i;
-      comp_size = MZ_READ_LE32(p + MZ_ZIP_CDH_COMPRESSED_SIZE_OFS);
-      decomp_size = MZ_READ_LE32(p + MZ_ZIP_CDH_DECOMPRESSED_SIZE_OFS);
-      if (((!MZ_READ_LE32(p + MZ_ZIP_CDH_METHOD_OFS)) && (decomp_size != comp_size)) || (decomp_size && !comp_size) || (decomp_size == 0xFFFFFFFF) || (comp_size == 0xFFFFFFFF))
+      if ((total_header_size = MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + MZ_READ_LE16(p + MZ_ZIP_CDH_FILENAME_LEN_OFS) + MZ_READ_LE16(p + MZ_ZIP_CDH_EXTRA_LEN_OFS) + MZ_READ_LE16(p + MZ_ZIP_CDH_COMMENT_LEN_OFS)) > n)
+        return MZ_FALSE;
+      if (!mz_zip_reader_get_cdh_sizes(p, &comp_size, &decomp_size, &local_header_ofs))
+        return MZ_FALSE;
+      if (((!MZ_READ_LE16(p + MZ_ZIP_CDH_METHOD_OFS)) && (decomp_size != comp_size)) || (decomp_size && !comp_size))
         return MZ_FALSE;
       disk_index = MZ_READ_LE16(p + MZ_ZIP_CDH_DISK_START_OFS);
       if ((disk_index != num_this_disk) && (disk_index != 1))
         return MZ_FALSE;
-      if (((mz_uint64)MZ_READ_LE32(p + MZ_ZIP_CDH_LOCAL_HEADER_OFS) + MZ_ZIP_LOCAL_DIR_HEADER_SIZE + comp_size) > pZip->m_archive_size)
-        return MZ_FALSE;
-      if ((total_header_size = MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + MZ_READ_LE16(p + MZ_ZIP_CDH_FILENAME_LEN_OFS) + MZ_READ_LE16(p + MZ_ZIP_CDH_EXTRA_LEN_OFS) + MZ_READ_LE16(p + MZ_ZIP_CDH_COMMENT_LEN_OFS)) > n)
+      if ((local_header_ofs + MZ_ZIP_LOCAL_DIR_HEADER_SIZE + comp_size) > pZip->m_archive_size)
         return MZ_FALSE;
       n -= total_header_size; p += total_header_size;
     }
@@ -2548,10 +2813,35 @@ static size_t mz_zip_file_read_func(void *pOpaque, mz_uint64 file_ofs, void *pBu
   return MZ_FREAD(pBuf, 1, n, pZip->m_pState->m_pFile);
 }
 
+#ifdef MINIZ_HAS_PREAD
+// Reads at an absolute offset without touching the file's position, so concurrent extractions don't need to serialize on the archive file.
+static size_t mz_zip_file_pread_func(void *pOpaque, mz_uint64 file_ofs, void *pBuf, size_t n)
+{
+  mz_zip_archive *pZip = (mz_zip_archive *)pOpaque;
+  int fd = fileno(pZip->m_pState->m_pFile);
+  size_t total = 0;
+  if ((mz_uint64)(off_t)file_ofs != file_ofs)
+    return 0;
+  while (total < n)
+  {
+    ssize_t read_size = pread(fd, (mz_uint8 *)pBuf + total, n - total, (off_t)(file_ofs + total));
+    if (read_size <= 0)
+      break;
+    total += (size_t)read_size;
+  }
+  return total;
+}
+#endif
+
 mz_bool mz_zip_reader_init_file(mz_zip_archive *pZip, const char *pFilename, mz_uint32 flags)
 {
   mz_uint64 file_size;
-  MZ_FILE *pFile = MZ_FOPEN(pFilename, "rb");
+  MZ_FILE *pFile;
+#ifndef MINIZ_HAS_PREAD
+  if (flags & MZ_ZIP_FLAG_POSITIONAL_READS)
+    return MZ_FALSE;
+#endif
+  pFile = MZ_FOPEN(pFilename, "rb");
   if (!pFile)
     return MZ_FALSE;
   if (MZ_FSEEK64(pFile, 0, SEEK_END))
@@ -2566,6 +2856,10 @@ mz_bool mz_zip_reader_init_file(mz_zip_archive *pZip, const char *pFilename, mz_
     return MZ_FALSE;
   }
   pZip->m_pRead = mz_zip_file_read_func;
+#ifdef MINIZ_HAS_PREAD
+  if (flags & MZ_ZIP_FLAG_POSITIONAL_READS)
+    pZip->m_pRead = mz_zip_file_pread_func;
+#endif
   pZip->m_pIO_opaque = pZip;
   pZip->m_pState->m_pFile = pFile;
   pZip->m_archive_size = file_size;
@@ -2643,11 +2937,10 @@ mz_bool mz_zip_reader_file_stat(mz_zip_archive *pZip, mz_uint file_index, mz_zip
   pStat->m_time = mz_zip_dos_to_time_t(MZ_READ_LE16(p + MZ_ZIP_CDH_FILE_TIME_OFS), MZ_READ_LE16(p + MZ_ZIP_CDH_FILE_DATE_OFS));
 #endif
   pStat->m_crc32 = MZ_READ_LE32(p + MZ_ZIP_CDH_CRC32_OFS);
-  pStat->m_comp_size = MZ_READ_LE32(p + MZ_ZIP_CDH_COMPRESSED_SIZE_OFS);
-  pStat->m_uncomp_size = MZ_READ_LE32(p + MZ_ZIP_CDH_DECOMPRESSED_SIZE_OFS);
+  if (!mz_zip_reader_get_cdh_sizes(p, &pStat->m_comp_size, &pStat->m_uncomp_size, &pStat->m_local_header_ofs))
+    return MZ_FALSE;
   pStat->m_internal_attr = MZ_READ_LE16(p + MZ_ZIP_CDH_INTERNAL_ATTR_OFS);
   pStat->m_external_attr = MZ_READ_LE32(p + MZ_ZIP_CDH_EXTERNAL_ATTR_OFS);
-  pStat->m_local_header_ofs = MZ_READ_LE32(p + MZ_ZIP_CDH_LOCAL_HEADER_OFS);
 
   // Copy as much of the filename and comment as possible.
   n = MZ_READ_LE16(p + MZ_ZIP_CDH_FILENAME_LEN_OFS); n = MZ_MIN(n, MZ_ZIP_MAX_ARCHIVE_FILENAME_SIZE - 1);
@@ -2764,6 +3057,103 @@ int mz_zip_reader_locate_file(mz_zip_archive *pZip, const char *pName, const cha
   return -1;
 }
 
+// Decodes an MZ_LZ4 entry's blocks either straight into pOut_buf, or one block at a time through pCallback, and checks the entry's CRC.
+static mz_bool mz_zip_reader_extract_lz4(mz_zip_archive *pZip, mz_uint64 cur_file_ofs, const mz_zip_archive_file_stat *pFile_stat, mz_uint8 *pOut_buf, mz_file_write_func pCallback, void *pOpaque, void *pUser_read_buf, size_t user_read_buf_size, mz_bool check_crc32)
+{
+  mz_uint64 comp_remaining = pFile_stat->m_comp_size, out_buf_ofs = 0;
+  mz_uint32 file_crc32 = MZ_CRC32_INIT;
+  mz_uint8 *pRead_buf = NULL, *pWrite_buf = NULL;
+  mz_bool status = MZ_TRUE;
+
+  if (!pZip->m_pState->m_pMem)
+  {
+    if ((pUser_read_buf) && (user_read_buf_size >= MZ_LZ4_BLOCK_SIZE))
+      pRead_buf = (mz_uint8 *)pUser_read_buf;
+    else if (NULL == (pRead_buf = (mz_uint8 *)pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, MZ_LZ4_BLOCK_SIZE)))
+      return MZ_FALSE;
+  }
+  if ((!pOut_buf) && (NULL == (pWrite_buf = (mz_uint8 *)pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, MZ_LZ4_BLOCK_SIZE))))
+    status = MZ_FALSE;
+
+  while ((status) && (comp_remaining))
+  {
+    mz_uint32 header_u32; const mz_uint8 *pHeader = (const mz_uint8 *)&header_u32, *pBlock;
+    mz_uint32 block_header;
+    size_t block_size, out_size = (size_t)MZ_MIN(MZ_LZ4_BLOCK_SIZE, pFile_stat->m_uncomp_size - out_buf_ofs);
+    mz_uint8 *pDst = pOut_buf ? (pOut_buf + out_buf_ofs) : pWrite_buf;
+
+    if (comp_remaining < MZ_LZ4_BLOCK_HEADER_SIZE)
+    {
+      status = MZ_FALSE;
+      break;
+    }
+    if (pZip->m_pState->m_pMem)
+      pHeader = (const mz_uint8 *)pZip->m_pState->m_pMem + cur_file_ofs;
+    else if (pZip->m_pRead(pZip->m_pIO_opaque, cur_file_ofs, &header_u32, MZ_LZ4_BLOCK_HEADER_SIZE) != MZ_LZ4_BLOCK_HEADER_SIZE)
+    {
+      status = MZ_FALSE;
+      break;
+    }
+    block_header = MZ_READ_LE32(pHeader);
+    block_size = block_header & ~MZ_LZ4_BLOCK_STORED;
+    cur_file_ofs += MZ_LZ4_BLOCK_HEADER_SIZE;
+    comp_remaining -= MZ_LZ4_BLOCK_HEADER_SIZE;
+
+    // Every block but the last one has to decode to exactly MZ_LZ4_BLOCK_SIZE bytes.
+    if ((!out_size) || (block_size > MZ_LZ4_BLOCK_SIZE) || (block_size > comp_remaining) || ((block_header & MZ_LZ4_BLOCK_STORED) && (block_size != out_size)))
+    {
+      status = MZ_FALSE;
+      break;
+    }
+
+    if (pZip->m_pState->m_pMem)
+      pBlock = (const mz_uint8 *)pZip->m_pState->m_pMem + cur_file_ofs;
+    else
+    {
+      // Stored blocks are read straight into their destination.
+      pBlock = (block_header & MZ_LZ4_BLOCK_STORED) ? pDst : pRead_buf;
+      if (pZip->m_pRead(pZip->m_pIO_opaque, cur_file_ofs, (void *)pBlock, block_size) != block_size)
+      {
+        status = MZ_FALSE;
+        break;
+      }
+    }
+
+    if (block_header & MZ_LZ4_BLOCK_STORED)
+    {
+      if (pBlock != pDst)
+        memcpy(pDst, pBlock, block_size);
+    }
+    else if (mz_lz4_decompress_block(pBlock, block_size, pDst, out_size) != (int)out_size)
+    {
+      status = MZ_FALSE;
+      break;
+    }
+    cur_file_ofs += block_size;
+    comp_remaining -= block_size;
+
+    if (check_crc32)
+      file_crc32 = (mz_uint32)mz_crc32(file_crc32, pDst, out_size);
+    if ((!pOut_buf) && (pCallback(pOpaque, out_buf_ofs, pDst, out_size) != out_size))
+    {
+      status = MZ_FALSE;
+      break;
+    }
+    out_buf_ofs += out_size;
+  }
+
+  // Make sure the entire file was decompressed, and check its CRC.
+  if ((status) && ((out_buf_ofs != pFile_stat->m_uncomp_size) || ((check_crc32) && (file_crc32 != pFile_stat->m_crc32))))
+    status = MZ_FALSE;
+
+  if ((pRead_buf) && (pRead_buf != pUser_read_buf))
+    pZip->m_pFree(pZip->m_pAlloc_opaque, pRead_buf);
+  if (pWrite_buf)
+    pZip->m_pFree(pZip->m_pAlloc_opaque, pWrite_buf);
+
+  return status;
+}
+
 mz_bool mz_zip_reader_extract_to_mem_no_alloc(mz_zip_archive *pZip, mz_uint file_index, void *pBuf, size_t buf_size, mz_uint flags, void *pUser_read_buf, size_t user_read_buf_size)
 {
   int status = TINFL_STATUS_DONE;
@@ -2792,8 +3182,8 @@ mz_bool mz_zip_reader_extract_to_mem_no_alloc(mz_zip_archive *pZip, mz_uint file
   if (file_stat.m_bit_flag & (1 | 32))
     return MZ_FALSE;
 
-  // This function only supports stored and deflate.
-  if ((!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA)) && (file_stat.m_method != 0) && (file_stat.m_method != MZ_DEFLATED))
+  // This function only supports stored, deflate and LZ4.
+  if ((!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA)) && (file_stat.m_method != 0) && (file_stat.m_method != MZ_DEFLATED) && (file_stat.m_method != MZ_LZ4))
     return MZ_FALSE;
 
   // Ensure supplied output buffer is large enough.
@@ -2820,6 +3210,9 @@ mz_bool mz_zip_reader_extract_to_mem_no_alloc(mz_zip_archive *pZip, mz_uint file
     return ((flags & MZ_ZIP_FLAG_COMPRESSED_DATA) != 0) || (mz_crc32(MZ_CRC32_INIT, (const mz_uint8 *)pBuf, (size_t)file_stat.m_uncomp_size) == file_stat.m_crc32);
   }
 
+  if (file_stat.m_method == MZ_LZ4)
+    return mz_zip_reader_extract_lz4(pZip, cur_file_ofs, &file_stat, (mz_uint8 *)pBuf, NULL, NULL, pUser_read_buf, user_read_buf_size, MZ_TRUE);
+
   // Decompress the file either directly from memory or from a file input buffer.
   tinfl_init(&inflator);
 
@@ -2920,8 +3313,8 @@ void *mz_zip_reader_extract_to_heap(mz_zip_archive *pZip, mz_uint file_index, si
   if (!p)
     return NULL;
 
-  comp_size = MZ_READ_LE32(p + MZ_ZIP_CDH_COMPRESSED_SIZE_OFS);
-  uncomp_size = MZ_READ_LE32(p + MZ_ZIP_CDH_DECOMPRESSED_SIZE_OFS);
+  if (!mz_zip_reader_get_cdh_sizes(p, &comp_size, &uncomp_size, NULL))
+    return NULL;
 
   alloc_size = (flags & MZ_ZIP_FLAG_COMPRESSED_DATA) ? comp_size : uncomp_size;
 #ifdef _MSC_VER
@@ -2954,9 +3347,46 @@ void *mz_zip_reader_extract_file_to_heap(mz_zip_archive *pZip, const char *pFile
   return mz_zip_reader_extract_to_heap(pZip, file_index, pSize, flags);
 }
 
+// Copies a stored entry's data to the callback a block at a time. The first read is cut short so the following ones start at MZ_ZIP_STORED_BLOCK_SIZE aligned archive offsets.
+// pCrc32 may be NULL if the caller doesn't want the data checksummed.
+static mz_bool mz_zip_reader_extract_stored_to_callback(mz_zip_archive *pZip, mz_uint64 cur_file_ofs, mz_uint64 size, mz_file_write_func pCallback, void *pOpaque, mz_uint32 *pCrc32)
+{
+  mz_uint64 out_buf_ofs = 0;
+  size_t buf_size = (size_t)MZ_MIN(size, MZ_ZIP_STORED_BLOCK_SIZE);
+  void *pRaw_buf;
+  mz_uint8 *pBuf;
+  mz_bool status = MZ_TRUE;
+
+  if (!size)
+    return MZ_TRUE;
+  // Keep the buffer cache line aligned, so the platform's file layer can DMA straight into it.
+  if (NULL == (pRaw_buf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, buf_size + 63)))
+    return MZ_FALSE;
+  pBuf = (mz_uint8 *)(((size_t)pRaw_buf + 63) & ~(size_t)63);
+
+  while (size)
+  {
+    size_t n = (size_t)MZ_MIN(size, MZ_ZIP_STORED_BLOCK_SIZE - (cur_file_ofs & (MZ_ZIP_STORED_BLOCK_SIZE - 1)));
+    if ((pZip->m_pRead(pZip->m_pIO_opaque, cur_file_ofs, pBuf, n) != n) || (pCallback(pOpaque, out_buf_ofs, pBuf, n) != n))
+    {
+      status = MZ_FALSE;
+      break;
+    }
+    if (pCrc32)
+      *pCrc32 = (mz_uint32)mz_crc32(*pCrc32, pBuf, n);
+    cur_file_ofs += n;
+    out_buf_ofs += n;
+    size -= n;
+  }
+
+  pZip->m_pFree(pZip->m_pAlloc_opaque, pRaw_buf);
+  return status;
+}
+
 mz_bool mz_zip_reader_extract_to_callback(mz_zip_archive *pZip, mz_uint file_index, mz_file_write_func pCallback, void *pOpaque, mz_uint flags)
 {
   int status = TINFL_STATUS_DONE; mz_uint file_crc32 = MZ_CRC32_INIT;
+  mz_bool check_crc32 = !(flags & (MZ_ZIP_FLAG_COMPRESSED_DATA | MZ_ZIP_FLAG_NO_CRC32_CHECK));
   mz_uint64 read_buf_size, read_buf_ofs = 0, read_buf_avail, comp_remaining, out_buf_ofs = 0, cur_file_ofs;
   mz_zip_archive_file_stat file_stat;
   void *pRead_buf = NULL; void *pWrite_buf = NULL;
@@ -2978,8 +3408,8 @@ mz_bool mz_zip_reader_extract_to_callback(mz_zip_archive *pZip, mz_uint file_ind
   if (file_stat.m_bit_flag & (1 | 32))
     return MZ_FALSE;
 
-  // This function only supports stored and deflate.
-  if ((!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA)) && (file_stat.m_method != 0) && (file_stat.m_method != MZ_DEFLATED))
+  // This function only supports stored, deflate and LZ4.
+  if ((!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA)) && (file_stat.m_method != 0) && (file_stat.m_method != MZ_DEFLATED) && (file_stat.m_method != MZ_LZ4))
     return MZ_FALSE;
 
   // Read and parse the local directory entry.
@@ -2993,6 +3423,18 @@ mz_bool mz_zip_reader_extract_to_callback(mz_zip_archive *pZip, mz_uint file_ind
   if ((cur_file_ofs + file_stat.m_comp_size) > pZip->m_archive_size)
     return MZ_FALSE;
 
+  // LZ4 entries decode a block at a time, so they don't need the large read buffer.
+  if ((!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA)) && (file_stat.m_method == MZ_LZ4))
+    return mz_zip_reader_extract_lz4(pZip, cur_file_ofs, &file_stat, NULL, pCallback, pOpaque, NULL, 0, check_crc32);
+
+  // Stored entries from files are copied in large aligned blocks, also without the large read buffer.
+  if (((flags & MZ_ZIP_FLAG_COMPRESSED_DATA) || (!file_stat.m_method)) && (!pZip->m_pState->m_pMem))
+  {
+    if (!mz_zip_reader_extract_stored_to_callback(pZip, cur_file_ofs, file_stat.m_comp_size, pCallback, pOpaque, check_crc32 ? &file_crc32 : NULL))
+      return MZ_FALSE;
+    return (!check_crc32) || (file_crc32 == file_stat.m_crc32);
+  }
+
   // Decompress the file either directly from memory or from a file input buffer.
   if (pZip->m_pState->m_pMem)
   {
@@ -3011,47 +3453,20 @@ mz_bool mz_zip_reader_extract_to_callback(mz_zip_archive *pZip, mz_uint file_ind
 
   if ((flags & MZ_ZIP_FLAG_COMPRESSED_DATA) || (!file_stat.m_method))
   {
-    // The file is stored or the caller has requested the compressed data.
-    if (pZip->m_pState->m_pMem)
-    {
+    // The file is stored or the caller has requested the compressed data, and the archive is in memory.
 #ifdef _MSC_VER
-      if (((0, sizeof(size_t) == sizeof(mz_uint32))) && (file_stat.m_comp_size > 0xFFFFFFFF))
+    if (((0, sizeof(size_t) == sizeof(mz_uint32))) && (file_stat.m_comp_size > 0xFFFFFFFF))
 #else
-      if (((sizeof(size_t) == sizeof(mz_uint32))) && (file_stat.m_comp_size > 0xFFFFFFFF))
+    if (((sizeof(size_t) == sizeof(mz_uint32))) && (file_stat.m_comp_size > 0xFFFFFFFF))
 #endif
-        return MZ_FALSE;
-      if (pCallback(pOpaque, out_buf_ofs, pRead_buf, (size_t)file_stat.m_comp_size) != file_stat.m_comp_size)
-        status = TINFL_STATUS_FAILED;
-      else if (!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA))
-        file_crc32 = (mz_uint32)mz_crc32(file_crc32, (const mz_uint8 *)pRead_buf, (size_t)file_stat.m_comp_size);
-      cur_file_ofs += file_stat.m_comp_size;
-      out_buf_ofs += file_stat.m_comp_size;
-      comp_remaining = 0;
-    }
-    else
-    {
-      while (comp_remaining)
-      {
-        read_buf_avail = MZ_MIN(read_buf_size, comp_remaining);
-        if (pZip->m_pRead(pZip->m_pIO_opaque, cur_file_ofs, pRead_buf, (size_t)read_buf_avail) != read_buf_avail)
-        {
-          status = TINFL_STATUS_FAILED;
-          break;
-        }
-
-        if (!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA))
-          file_crc32 = (mz_uint32)mz_crc32(file_crc32, (const mz_uint8 *)pRead_buf, (size_t)read_buf_avail);
-
-        if (pCallback(pOpaque, out_buf_ofs, pRead_buf, (size_t)read_buf_avail) != read_buf_avail)
-        {
-          status = TINFL_STATUS_FAILED;
-          break;
-        }
-        cur_file_ofs += read_buf_avail;
-        out_buf_ofs += read_buf_avail;
-        comp_remaining -= read_buf_avail;
-      }
-    }
+      return MZ_FALSE;
+    if (pCallback(pOpaque, out_buf_ofs, pRead_buf, (size_t)file_stat.m_comp_size) != file_stat.m_comp_size)
+      status = TINFL_STATUS_FAILED;
+    else if (check_crc32)
+      file_crc32 = (mz_uint32)mz_crc32(file_crc32, (const mz_uint8 *)pRead_buf, (size_t)file_stat.m_comp_size);
+    cur_file_ofs += file_stat.m_comp_size;
+    out_buf_ofs += file_stat.m_comp_size;
+    comp_remaining = 0;
   }
   else
   {
@@ -3091,7 +3506,8 @@ mz_bool mz_zip_reader_extract_to_callback(mz_zip_archive *pZip, mz_uint file_ind
             status = TINFL_STATUS_FAILED;
             break;
           }
-          file_crc32 = (mz_uint32)mz_crc32(file_crc32, pWrite_buf_cur, out_buf_size);
+          if (check_crc32)
+            file_crc32 = (mz_uint32)mz_crc32(file_crc32, pWrite_buf_cur, out_buf_size);
           if ((out_buf_ofs += out_buf_size) > file_stat.m_uncomp_size)
           {
             status = TINFL_STATUS_FAILED;
@@ -3105,7 +3521,7 @@ mz_bool mz_zip_reader_extract_to_callback(mz_zip_archive *pZip, mz_uint file_ind
   if ((status == TINFL_STATUS_DONE) && (!(flags & MZ_ZIP_FLAG_COMPRESSED_DATA)))
   {
     // Make sure the entire file was decompressed, and check its CRC.
-    if ((out_buf_ofs != file_stat.m_uncomp_size) || (file_crc32 != file_stat.m_crc32))
+    if ((out_buf_ofs != file_stat.m_uncomp_size) || ((check_crc32) && (file_crc32 != file_stat.m_crc32)))
       status = TINFL_STATUS_FAILED;
   }
 
@@ -3131,6 +3547,112 @@ static size_t mz_zip_file_write_callback(void *pOpaque, mz_uint64 ofs, const voi
   (void)ofs; return MZ_FWRITE(pBuf, 1, n, (MZ_FILE*)pOpaque);
 }
 
+#ifdef MINIZ_USE_COPY_FILE_RANGE
+typedef struct
+{
+  int m_fd;
+  mz_uint64 m_ofs, m_size;
+  mz_uint32 m_crc32;
+  mz_bool m_status;
+} mz_zip_crc32_job;
+
+static void *mz_zip_crc32_job_func(void *pArg)
+{
+  mz_zip_crc32_job *pJob = (mz_zip_crc32_job *)pArg;
+  mz_uint64 ofs = pJob->m_ofs, remaining = pJob->m_size;
+  mz_uint8 *pBuf = (mz_uint8 *)MZ_MALLOC(MZ_ZIP_STORED_BLOCK_SIZE);
+  pJob->m_crc32 = MZ_CRC32_INIT;
+  pJob->m_status = (pBuf != NULL);
+  while ((pJob->m_status) && (remaining))
+  {
+    ssize_t n = pread(pJob->m_fd, pBuf, (size_t)MZ_MIN(remaining, MZ_ZIP_STORED_BLOCK_SIZE), (off_t)ofs);
+    if (n <= 0)
+      pJob->m_status = MZ_FALSE;
+    else
+    {
+      pJob->m_crc32 = (mz_uint32)mz_crc32(pJob->m_crc32, pBuf, (size_t)n);
+      ofs += n; remaining -= n;
+    }
+  }
+  MZ_FREE(pBuf);
+  return NULL;
+}
+
+// Copies a stored entry from the archive file to the destination inside the kernel, using copy_file_range() or sendfile() on older kernels,
+// while a worker thread checksums the source. Returns -1 without writing anything if neither works for these files, so the caller can fall back to a regular copy.
+static int mz_zip_reader_copy_stored_file_linux(mz_zip_archive *pZip, const mz_zip_archive_file_stat *pFile_stat, MZ_FILE *pDst_file, mz_uint flags)
+{
+  mz_uint32 local_header_u32[(MZ_ZIP_LOCAL_DIR_HEADER_SIZE + sizeof(mz_uint32) - 1) / sizeof(mz_uint32)]; mz_uint8 *pLocal_header = (mz_uint8 *)local_header_u32;
+  int src_fd = fileno(pZip->m_pState->m_pFile), dst_fd = fileno(pDst_file);
+  mz_bool check_crc32 = !(flags & (MZ_ZIP_FLAG_COMPRESSED_DATA | MZ_ZIP_FLAG_NO_CRC32_CHECK)), use_sendfile = MZ_FALSE, status = MZ_TRUE;
+  mz_zip_crc32_job job;
+  pthread_t crc32_thread;
+  mz_bool crc32_thread_started = MZ_FALSE;
+  loff_t src_ofs, dst_ofs = 0;
+  mz_uint64 remaining = pFile_stat->m_comp_size;
+
+  if ((pFile_stat->m_bit_flag & (1 | 32)) || (!remaining))
+    return -1;
+
+  // Find the start of the entry's data past the local header.
+  if (pZip->m_pRead(pZip->m_pIO_opaque, pFile_stat->m_local_header_ofs, pLocal_header, MZ_ZIP_LOCAL_DIR_HEADER_SIZE) != MZ_ZIP_LOCAL_DIR_HEADER_SIZE)
+    return MZ_FALSE;
+  if (MZ_READ_LE32(pLocal_header) != MZ_ZIP_LOCAL_DIR_HEADER_SIG)
+    return MZ_FALSE;
+  src_ofs = (loff_t)(pFile_stat->m_local_header_ofs + MZ_ZIP_LOCAL_DIR_HEADER_SIZE + MZ_READ_LE16(pLocal_header + MZ_ZIP_LDH_FILENAME_LEN_OFS) + MZ_READ_LE16(pLocal_header + MZ_ZIP_LDH_EXTRA_LEN_OFS));
+  if (((mz_uint64)src_ofs + remaining) > pZip->m_archive_size)
+    return MZ_FALSE;
+
+  job.m_fd = src_fd; job.m_ofs = (mz_uint64)src_ofs; job.m_size = remaining;
+
+  while (remaining)
+  {
+    size_t n = (size_t)MZ_MIN(remaining, MZ_ZIP_MAX_IO_BUF_SIZE);
+    ssize_t copied;
+    if (!use_sendfile)
+      copied = copy_file_range(src_fd, &src_ofs, dst_fd, &dst_ofs, n, 0);
+    else
+    {
+      off_t sendfile_ofs = (off_t)src_ofs;
+      copied = sendfile(dst_fd, src_fd, &sendfile_ofs, n);
+      src_ofs = sendfile_ofs;
+    }
+
+    if (copied <= 0)
+    {
+      // Nothing has been written yet, so try sendfile() and then give up to the regular copy.
+      if ((copied < 0) && (remaining == pFile_stat->m_comp_size) && ((errno == ENOSYS) || (errno == EXDEV) || (errno == EINVAL) || (errno == EOPNOTSUPP)))
+      {
+        if (!use_sendfile)
+        {
+          use_sendfile = MZ_TRUE;
+          continue;
+        }
+        return -1;
+      }
+      status = MZ_FALSE;
+      break;
+    }
+    remaining -= copied;
+
+    // Start checksumming once the copy is known to work.
+    if ((check_crc32) && (!crc32_thread_started))
+      crc32_thread_started = (pthread_create(&crc32_thread, NULL, mz_zip_crc32_job_func, &job) == 0);
+  }
+
+  if (check_crc32)
+  {
+    if (crc32_thread_started)
+      pthread_join(crc32_thread, NULL);
+    else
+      mz_zip_crc32_job_func(&job);
+    if ((status) && ((!job.m_status) || (job.m_crc32 != pFile_stat->m_crc32)))
+      status = MZ_FALSE;
+  }
+  return status;
+}
+#endif // #ifdef MINIZ_USE_COPY_FILE_RANGE
+
 mz_bool mz_zip_reader_extract_to_file(mz_zip_archive *pZip, mz_uint file_index, const char *pDst_filename, mz_uint flags)
 {
   mz_bool status;
@@ -3141,6 +3663,14 @@ mz_bool mz_zip_reader_extract_to_file(mz_zip_archive *pZip, mz_uint file_index,
   pFile = MZ_FOPEN(pDst_filename, "wb");
   if (!pFile)
     return MZ_FALSE;
+#ifdef MINIZ_USE_COPY_FILE_RANGE
+  if (((pZip->m_pRead == mz_zip_file_read_func) || (pZip->m_pRead == mz_zip_file_pread_func)) && ((flags & MZ_ZIP_FLAG_COMPRESSED_DATA) || (!file_stat.m_method)) && (!mz_zip_reader_is_file_a_directory(pZip, file_index)))
+  {
+    int copy_status = mz_zip_reader_copy_stored_file_linux(pZip, &file_stat, pFile, flags);
+    status = (copy_status < 0) ? mz_zip_reader_extract_to_callback(pZip, file_index, mz_zip_file_write_callback, pFile, flags) : (mz_bool)copy_status;
+  }
+  else
+#endif
   status = mz_zip_reader_extract_to_callback(pZip, file_index, mz_zip_file_write_callback, pFile, flags);
   if (MZ_FCLOSE(pFile) == EOF)
     return MZ_FALSE;
@@ -3195,8 +3725,11 @@ mz_bool mz_zip_reader_extract_file_to_file(mz_zip_archive *pZip, const char *pAr
 
 static void mz_write_le16(mz_uint8 *p, mz_uint16 v) { p[0] = (mz_uint8)v; p[1] = (mz_uint8)(v >> 8); }
 static void mz_write_le32(mz_uint8 *p, mz_uint32 v) { p[0] = (mz_uint8)v; p[1] = (mz_uint8)(v >> 8); p[2] = (mz_uint8)(v >> 16); p[3] = (mz_uint8)(v >> 24); }
+static void mz_write_le64(mz_uint8 *p, mz_uint64 v) { mz_write_le32(p, (mz_uint32)v); mz_write_le32(p + sizeof(mz_uint32), (mz_uint32)(v >> 32)); }
 #define MZ_WRITE_LE16(p, v) mz_write_le16((mz_uint8 *)(p), (mz_uint16)(v))
 #define MZ_WRITE_LE32(p, v) mz_write_le32((mz_uint8 *)(p), (mz_uint32)(v))
+#define MZ_WRITE_LE64(p, v) mz_write_le64((mz_uint8 *)(p), (mz_uint64)(v))
+#define MZ_ZIP32_FIELD(v) (((v) >= MZ_ZIP32_MAX_FIELD_VALUE) ? MZ_ZIP32_MAX_FIELD_VALUE : (mz_uint32)(v))
 
 mz_bool mz_zip_writer_init(mz_zip_archive *pZip, mz_uint64 existing_size)
 {
@@ -3317,7 +3850,7 @@ mz_bool mz_zip_writer_init_from_reader(mz_zip_archive *pZip, const char *pFilena
   if ((!pZip) || (!pZip->m_pState) || (pZip->m_zip_mode != MZ_ZIP_MODE_READING))
     return MZ_FALSE;
   // No sense in trying to write to an archive that's already at the support max size
-  if ((pZip->m_total_files == 0xFFFF) || ((pZip->m_archive_size + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + MZ_ZIP_LOCAL_DIR_HEADER_SIZE) > 0xFFFFFFFF))
+  if (pZip->m_total_files == MZ_ZIP32_MAX_FIELD_VALUE)
     return MZ_FALSE;
 
   pState = pZip->m_pState;
@@ -3383,19 +3916,50 @@ static mz_bool mz_zip_writer_add_put_buf_callback(const void* pBuf, int len, voi
   return MZ_TRUE;
 }
 
+typedef struct
+{
+  mz_uint16 m_hash[MZ_LZ4_HASH_SIZE];
+  mz_uint8 m_block[MZ_LZ4_BLOCK_HEADER_SIZE + MZ_LZ4_BLOCK_SIZE];
+} mz_zip_writer_lz4_compressor;
+
+// Appends a buffer to an MZ_LZ4 entry. Blocks which don't shrink are stored raw. Since blocks are cut at MZ_LZ4_BLOCK_SIZE boundaries of each buffer,
+// buf_size must be a multiple of MZ_LZ4_BLOCK_SIZE for every buffer but the entry's last one.
+static mz_bool mz_zip_writer_add_lz4_blocks(mz_zip_writer_add_state *pState, mz_zip_writer_lz4_compressor *pComp, const void *pBuf, size_t buf_size)
+{
+  const mz_uint8 *pSrc = (const mz_uint8 *)pBuf;
+  while (buf_size)
+  {
+    size_t n = MZ_MIN(buf_size, MZ_LZ4_BLOCK_SIZE);
+    size_t block_size = mz_lz4_compress_block(pSrc, n, pComp->m_block + MZ_LZ4_BLOCK_HEADER_SIZE, n - 1, pComp->m_hash);
+    if (block_size)
+      MZ_WRITE_LE32(pComp->m_block, block_size);
+    else
+    {
+      memcpy(pComp->m_block + MZ_LZ4_BLOCK_HEADER_SIZE, pSrc, n);
+      block_size = n;
+      MZ_WRITE_LE32(pComp->m_block, block_size | MZ_LZ4_BLOCK_STORED);
+    }
+    if (!mz_zip_writer_add_put_buf_callback(pComp->m_block, (int)(MZ_LZ4_BLOCK_HEADER_SIZE + block_size), pState))
+      return MZ_FALSE;
+    pSrc += n; buf_size -= n;
+  }
+  return MZ_TRUE;
+}
+
 static mz_bool mz_zip_writer_create_local_dir_header(mz_zip_archive *pZip, mz_uint8 *pDst, mz_uint16 filename_size, mz_uint16 extra_size, mz_uint64 uncomp_size, mz_uint64 comp_size, mz_uint32 uncomp_crc32, mz_uint16 method, mz_uint16 bit_flags, mz_uint16 dos_time, mz_uint16 dos_date)
 {
+  mz_bool zip64 = (uncomp_size >= MZ_ZIP32_MAX_FIELD_VALUE) || (comp_size >= MZ_ZIP32_MAX_FIELD_VALUE);
   (void)pZip;
   memset(pDst, 0, MZ_ZIP_LOCAL_DIR_HEADER_SIZE);
   MZ_WRITE_LE32(pDst + MZ_ZIP_LDH_SIG_OFS, MZ_ZIP_LOCAL_DIR_HEADER_SIG);
-  MZ_WRITE_LE16(pDst + MZ_ZIP_LDH_VERSION_NEEDED_OFS, method ? 20 : 0);
+  MZ_WRITE_LE16(pDst + MZ_ZIP_LDH_VERSION_NEEDED_OFS, zip64 ? 45 : (method ? 20 : 0));
   MZ_WRITE_LE16(pDst + MZ_ZIP_LDH_BIT_FLAG_OFS, bit_flags);
   MZ_WRITE_LE16(pDst + MZ_ZIP_LDH_METHOD_OFS, method);
   MZ_WRITE_LE16(pDst + MZ_ZIP_LDH_FILE_TIME_OFS, dos_time);
   MZ_WRITE_LE16(pDst + MZ_ZIP_LDH_FILE_DATE_OFS, dos_date);
   MZ_WRITE_LE32(pDst + MZ_ZIP_LDH_CRC32_OFS, uncomp_crc32);
-  MZ_WRITE_LE32(pDst + MZ_ZIP_LDH_COMPRESSED_SIZE_OFS, comp_size);
-  MZ_WRITE_LE32(pDst + MZ_ZIP_LDH_DECOMPRESSED_SIZE_OFS, uncomp_size);
+  MZ_WRITE_LE32(pDst + MZ_ZIP_LDH_COMPRESSED_SIZE_OFS, MZ_ZIP32_FIELD(comp_size));
+  MZ_WRITE_LE32(pDst + MZ_ZIP_LDH_DECOMPRESSED_SIZE_OFS, MZ_ZIP32_FIELD(uncomp_size));
   MZ_WRITE_LE16(pDst + MZ_ZIP_LDH_FILENAME_LEN_OFS, filename_size);
   MZ_WRITE_LE16(pDst + MZ_ZIP_LDH_EXTRA_LEN_OFS, extra_size);
   return MZ_TRUE;
@@ -3403,22 +3967,67 @@ static mz_bool mz_zip_writer_create_local_dir_header(mz_zip_archive *pZip, mz_ui
 
 static mz_bool mz_zip_writer_create_central_dir_header(mz_zip_archive *pZip, mz_uint8 *pDst, mz_uint16 filename_size, mz_uint16 extra_size, mz_uint16 comment_size, mz_uint64 uncomp_size, mz_uint64 comp_size, mz_uint32 uncomp_crc32, mz_uint16 method, mz_uint16 bit_flags, mz_uint16 dos_time, mz_uint16 dos_date, mz_uint64 local_header_ofs, mz_uint32 ext_attributes)
 {
+  mz_bool zip64 = (uncomp_size >= MZ_ZIP32_MAX_FIELD_VALUE) || (comp_size >= MZ_ZIP32_MAX_FIELD_VALUE) || (local_header_ofs >= MZ_ZIP32_MAX_FIELD_VALUE);
   (void)pZip;
   memset(pDst, 0, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE);
   MZ_WRITE_LE32(pDst + MZ_ZIP_CDH_SIG_OFS, MZ_ZIP_CENTRAL_DIR_HEADER_SIG);
-  MZ_WRITE_LE16(pDst + MZ_ZIP_CDH_VERSION_NEEDED_OFS, method ? 20 : 0);
+  MZ_WRITE_LE16(pDst + MZ_ZIP_CDH_VERSION_MADE_BY_OFS, zip64 ? 45 : 0);
+  MZ_WRITE_LE16(pDst + MZ_ZIP_CDH_VERSION_NEEDED_OFS, zip64 ? 45 : (method ? 20 : 0));
   MZ_WRITE_LE16(pDst + MZ_ZIP_CDH_BIT_FLAG_OFS, bit_flags);
   MZ_WRITE_LE16(pDst + MZ_ZIP_CDH_METHOD_OFS, method);
   MZ_WRITE_LE16(pDst + MZ_ZIP_CDH_FILE_TIME_OFS, dos_time);
   MZ_WRITE_LE16(pDst + MZ_ZIP_CDH_FILE_DATE_OFS, dos_date);
   MZ_WRITE_LE32(pDst + MZ_ZIP_CDH_CRC32_OFS, uncomp_crc32);
-  MZ_WRITE_LE32(pDst + MZ_ZIP_CDH_COMPRESSED_SIZE_OFS, comp_size);
-  MZ_WRITE_LE32(pDst + MZ_ZIP_CDH_DECOMPRESSED_SIZE_OFS, uncomp_size);
+  MZ_WRITE_LE32(pDst + MZ_ZIP_CDH_COMPRESSED_SIZE_OFS, MZ_ZIP32_FIELD(comp_size));
+  MZ_WRITE_LE32(pDst + MZ_ZIP_CDH_DECOMPRESSED_SIZE_OFS, MZ_ZIP32_FIELD(uncomp_size));
   MZ_WRITE_LE16(pDst + MZ_ZIP_CDH_FILENAME_LEN_OFS, filename_size);
   MZ_WRITE_LE16(pDst + MZ_ZIP_CDH_EXTRA_LEN_OFS, extra_size);
   MZ_WRITE_LE16(pDst + MZ_ZIP_CDH_COMMENT_LEN_OFS, comment_size);
   MZ_WRITE_LE32(pDst + MZ_ZIP_CDH_EXTERNAL_ATTR_OFS, ext_attributes);
-  MZ_WRITE_LE32(pDst + MZ_ZIP_CDH_LOCAL_HEADER_OFS, local_header_ofs);
+  MZ_WRITE_LE32(pDst + MZ_ZIP_CDH_LOCAL_HEADER_OFS, MZ_ZIP32_FIELD(local_header_ofs));
+  return MZ_TRUE;
+}
+
+// Builds a zip64 extended information extra field from the values which don't fit in their classic header fields. NULL values are left out. Returns the field's total size.
+static mz_uint mz_zip_writer_create_zip64_extra_data(mz_uint8 *pBuf, const mz_uint64 *pUncomp_size, const mz_uint64 *pComp_size, const mz_uint64 *pLocal_header_ofs)
+{
+  mz_uint8 *pDst = pBuf + sizeof(mz_uint16) * 2;
+  if (pUncomp_size) { MZ_WRITE_LE64(pDst, *pUncomp_size); pDst += sizeof(mz_uint64); }
+  if (pComp_size) { MZ_WRITE_LE64(pDst, *pComp_size); pDst += sizeof(mz_uint64); }
+  if (pLocal_header_ofs) { MZ_WRITE_LE64(pDst, *pLocal_header_ofs); pDst += sizeof(mz_uint64); }
+  MZ_WRITE_LE16(pBuf, MZ_ZIP64_EXTENDED_INFORMATION_FIELD_HEADER_ID);
+  MZ_WRITE_LE16(pBuf + sizeof(mz_uint16), (pDst - pBuf) - sizeof(mz_uint16) * 2);
+  return (mz_uint)(pDst - pBuf);
+}
+
+// Deflate can grow incompressible input by a few bytes per 64KB stored block, so anything this close to 4GB gets a zip64 local extra field reserved up front.
+static mz_bool mz_zip_writer_size_may_need_zip64(mz_uint64 size)
+{
+  return (size + (size >> 10) + 64) >= MZ_ZIP32_MAX_FIELD_VALUE;
+}
+
+// Writes the final local header, and the reserved zip64 local extra field (which always carries both sizes) if there is one.
+static mz_bool mz_zip_writer_write_local_dir_header(mz_zip_archive *pZip, mz_uint64 local_dir_header_ofs, mz_uint16 filename_size, mz_bool zip64, mz_uint64 uncomp_size, mz_uint64 comp_size, mz_uint32 uncomp_crc32, mz_uint16 method, mz_uint16 bit_flags, mz_uint16 dos_time, mz_uint16 dos_date)
+{
+  mz_uint8 local_dir_header[MZ_ZIP_LOCAL_DIR_HEADER_SIZE];
+  mz_uint8 extra_data[MZ_ZIP64_LOCAL_EXTRA_FIELD_SIZE];
+
+  if ((!zip64) && ((uncomp_size >= MZ_ZIP32_MAX_FIELD_VALUE) || (comp_size >= MZ_ZIP32_MAX_FIELD_VALUE)))
+    return MZ_FALSE;
+
+  if (!mz_zip_writer_create_local_dir_header(pZip, local_dir_header, filename_size, zip64 ? MZ_ZIP64_LOCAL_EXTRA_FIELD_SIZE : 0, zip64 ? MZ_ZIP32_MAX_FIELD_VALUE : uncomp_size, zip64 ? MZ_ZIP32_MAX_FIELD_VALUE : comp_size, uncomp_crc32, method, bit_flags, dos_time, dos_date))
+    return MZ_FALSE;
+
+  if (pZip->m_pWrite(pZip->m_pIO_opaque, local_dir_header_ofs, local_dir_header, sizeof(local_dir_header)) != sizeof(local_dir_header))
+    return MZ_FALSE;
+
+  if (zip64)
+  {
+    mz_zip_writer_create_zip64_extra_data(extra_data, &uncomp_size, &comp_size, NULL);
+    if (pZip->m_pWrite(pZip->m_pIO_opaque, local_dir_header_ofs + sizeof(local_dir_header) + filename_size, extra_data, sizeof(extra_data)) != sizeof(extra_data))
+      return MZ_FALSE;
+  }
+
   return MZ_TRUE;
 }
 
@@ -3428,16 +4037,27 @@ static mz_bool mz_zip_writer_add_to_central_dir(mz_zip_archive *pZip, const char
   mz_uint32 central_dir_ofs = (mz_uint32)pState->m_central_dir.m_size;
   size_t orig_central_dir_size = pState->m_central_dir.m_size;
   mz_uint8 central_dir_header[MZ_ZIP_CENTRAL_DIR_HEADER_SIZE];
+  mz_uint8 zip64_extra_data[MZ_ZIP64_MAX_CENTRAL_EXTRA_FIELD_SIZE];
+  mz_uint zip64_extra_size = 0;
+
+  if ((uncomp_size >= MZ_ZIP32_MAX_FIELD_VALUE) || (comp_size >= MZ_ZIP32_MAX_FIELD_VALUE) || (local_header_ofs >= MZ_ZIP32_MAX_FIELD_VALUE))
+  {
+    zip64_extra_size = mz_zip_writer_create_zip64_extra_data(zip64_extra_data,
+      (uncomp_size >= MZ_ZIP32_MAX_FIELD_VALUE) ? &uncomp_size : NULL,
+      (comp_size >= MZ_ZIP32_MAX_FIELD_VALUE) ? &comp_size : NULL,
+      (local_header_ofs >= MZ_ZIP32_MAX_FIELD_VALUE) ? &local_header_ofs : NULL);
+  }
 
-  // No zip64 support yet
-  if ((local_header_ofs > 0xFFFFFFFF) || (((mz_uint64)pState->m_central_dir.m_size + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + filename_size + extra_size + comment_size) > 0xFFFFFFFF))
+  // The central directory itself is still indexed with 32-bit offsets.
+  if (((mz_uint64)extra_size + zip64_extra_size > 0xFFFF) || (((mz_uint64)pState->m_central_dir.m_size + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + filename_size + zip64_extra_size + extra_size + comment_size) > MZ_ZIP32_MAX_FIELD_VALUE))
     return MZ_FALSE;
 
-  if (!mz_zip_writer_create_central_dir_header(pZip, central_dir_header, filename_size, extra_size, comment_size, uncomp_size, comp_size, uncomp_crc32, method, bit_flags, dos_time, dos_date, local_header_ofs, ext_attributes))
+  if (!mz_zip_writer_create_central_dir_header(pZip, central_dir_header, filename_size, (mz_uint16)(zip64_extra_size + extra_size), comment_size, uncomp_size, comp_size, uncomp_crc32, method, bit_flags, dos_time, dos_date, local_header_ofs, ext_attributes))
     return MZ_FALSE;
 
   if ((!mz_zip_array_push_back(pZip, &pState->m_central_dir, central_dir_header, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE)) ||
       (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pFilename, filename_size)) ||
+      (!mz_zip_array_push_back(pZip, &pState->m_central_dir, zip64_extra_data, zip64_extra_size)) ||
       (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pExtra, extra_size)) ||
       (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pComment, comment_size)) ||
       (!mz_zip_array_push_back(pZip, &pState->m_central_dir_offsets, &central_dir_ofs, 1)))
@@ -3495,7 +4115,8 @@ mz_bool mz_zip_writer_add_mem_ex(mz_zip_archive *pZip, const char *pArchive_name
   size_t archive_name_size;
   mz_uint8 local_dir_header[MZ_ZIP_LOCAL_DIR_HEADER_SIZE];
   tdefl_compressor *pComp = NULL;
-  mz_bool store_data_uncompressed;
+  mz_zip_writer_lz4_compressor *pLz4_comp = NULL;
+  mz_bool store_data_uncompressed, zip64;
   mz_zip_internal_state *pState;
 
   if ((int)level_and_flags < 0)
@@ -3503,16 +4124,14 @@ mz_bool mz_zip_writer_add_mem_ex(mz_zip_archive *pZip, const char *pArchive_name
   level = level_and_flags & 0xF;
   store_data_uncompressed = ((!level) || (level_and_flags & MZ_ZIP_FLAG_COMPRESSED_DATA));
 
-  if ((!pZip) || (!pZip->m_pState) || (pZip->m_zip_mode != MZ_ZIP_MODE_WRITING) || ((buf_size) && (!pBuf)) || (!pArchive_name) || ((comment_size) && (!pComment)) || (pZip->m_total_files == 0xFFFF) || (level > MZ_UBER_COMPRESSION))
+  if ((!pZip) || (!pZip->m_pState) || (pZip->m_zip_mode != MZ_ZIP_MODE_WRITING) || ((buf_size) && (!pBuf)) || (!pArchive_name) || ((comment_size) && (!pComment)) || (pZip->m_total_files == MZ_ZIP32_MAX_FIELD_VALUE) || (level > MZ_UBER_COMPRESSION))
     return MZ_FALSE;
 
   pState = pZip->m_pState;
 
   if ((!(level_and_flags & MZ_ZIP_FLAG_COMPRESSED_DATA)) && (uncomp_size))
     return MZ_FALSE;
-  // No zip64 support yet
-  if ((buf_size > 0xFFFFFFFF) || (uncomp_size > 0xFFFFFFFF))
-    return MZ_FALSE;
+  zip64 = mz_zip_writer_size_may_need_zip64(MZ_MAX((mz_uint64)buf_size, uncomp_size));
   if (!mz_zip_writer_validate_archive_name(pArchive_name))
     return MZ_FALSE;
 
@@ -3529,10 +4148,6 @@ mz_bool mz_zip_writer_add_mem_ex(mz_zip_archive *pZip, const char *pArchive_name
 
   num_alignment_padding_bytes = mz_zip_writer_compute_padding_needed_for_file_alignment(pZip);
 
-  // no zip64 support yet
-  if ((pZip->m_total_files == 0xFFFF) || ((pZip->m_archive_size + num_alignment_padding_bytes + MZ_ZIP_LOCAL_DIR_HEADER_SIZE + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + comment_size + archive_name_size) > 0xFFFFFFFF))
-    return MZ_FALSE;
-
   if ((archive_name_size) && (pArchive_name[archive_name_size - 1] == '/'))
   {
     // Set DOS Subdirectory attribute bit.
@@ -3543,18 +4158,24 @@ mz_bool mz_zip_writer_add_mem_ex(mz_zip_archive *pZip, const char *pArchive_name
   }
 
   // Try to do any allocations before writing to the archive, so if an allocation fails the file remains unmodified. (A good idea if we're doing an in-place modification.)
-  if ((!mz_zip_array_ensure_room(pZip, &pState->m_central_dir, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + archive_name_size + comment_size)) || (!mz_zip_array_ensure_room(pZip, &pState->m_central_dir_offsets, 1)))
+  if ((!mz_zip_array_ensure_room(pZip, &pState->m_central_dir, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + archive_name_size + MZ_ZIP64_MAX_CENTRAL_EXTRA_FIELD_SIZE + comment_size)) || (!mz_zip_array_ensure_room(pZip, &pState->m_central_dir_offsets, 1)))
     return MZ_FALSE;
 
   if ((!store_data_uncompressed) && (buf_size))
   {
-    if (NULL == (pComp = (tdefl_compressor *)pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, sizeof(tdefl_compressor))))
+    if (level_and_flags & MZ_ZIP_FLAG_COMPRESS_LZ4)
+    {
+      if (NULL == (pLz4_comp = (mz_zip_writer_lz4_compressor *)pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, sizeof(mz_zip_writer_lz4_compressor))))
+        return MZ_FALSE;
+    }
+    else if (NULL == (pComp = (tdefl_compressor *)pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, sizeof(tdefl_compressor))))
       return MZ_FALSE;
   }
 
   if (!mz_zip_writer_write_zeros(pZip, cur_archive_file_ofs, num_alignment_padding_bytes + sizeof(local_dir_header)))
   {
     pZip->m_pFree(pZip->m_pAlloc_opaque, pComp);
+    pZip->m_pFree(pZip->m_pAlloc_opaque, pLz4_comp);
     return MZ_FALSE;
   }
   local_dir_header_ofs += num_alignment_padding_bytes;
@@ -3565,10 +4186,23 @@ mz_bool mz_zip_writer_add_mem_ex(mz_zip_archive *pZip, const char *pArchive_name
   if (pZip->m_pWrite(pZip->m_pIO_opaque, cur_archive_file_ofs, pArchive_name, archive_name_size) != archive_name_size)
   {
     pZip->m_pFree(pZip->m_pAlloc_opaque, pComp);
+    pZip->m_pFree(pZip->m_pAlloc_opaque, pLz4_comp);
     return MZ_FALSE;
   }
   cur_archive_file_ofs += archive_name_size;
 
+  if (zip64)
+  {
+    // Reserve the zip64 local extra field, it's filled in along with the local header once the sizes are known.
+    if (!mz_zip_writer_write_zeros(pZip, cur_archive_file_ofs, MZ_ZIP64_LOCAL_EXTRA_FIELD_SIZE))
+    {
+      pZip->m_pFree(pZip->m_pAlloc_opaque, pComp);
+      pZip->m_pFree(pZip->m_pAlloc_opaque, pLz4_comp);
+      return MZ_FALSE;
+    }
+    cur_archive_file_ofs += MZ_ZIP64_LOCAL_EXTRA_FIELD_SIZE;
+  }
+
   if (!(level_and_flags & MZ_ZIP_FLAG_COMPRESSED_DATA))
   {
     uncomp_crc32 = (mz_uint32)mz_crc32(MZ_CRC32_INIT, (const mz_uint8*)pBuf, buf_size);
@@ -3585,6 +4219,7 @@ mz_bool mz_zip_writer_add_mem_ex(mz_zip_archive *pZip, const char *pArchive_name
     if (pZip->m_pWrite(pZip->m_pIO_opaque, cur_archive_file_ofs, pBuf, buf_size) != buf_size)
     {
       pZip->m_pFree(pZip->m_pAlloc_opaque, pComp);
+      pZip->m_pFree(pZip->m_pAlloc_opaque, pLz4_comp);
       return MZ_FALSE;
     }
 
@@ -3592,7 +4227,26 @@ mz_bool mz_zip_writer_add_mem_ex(mz_zip_archive *pZip, const char *pArchive_name
     comp_size = buf_size;
 
     if (level_and_flags & MZ_ZIP_FLAG_COMPRESSED_DATA)
-      method = MZ_DEFLATED;
+      method = (level_and_flags & MZ_ZIP_FLAG_COMPRESS_LZ4) ? MZ_LZ4 : MZ_DEFLATED;
+  }
+  else if ((buf_size) && (pLz4_comp))
+  {
+    mz_zip_writer_add_state state;
+
+    state.m_pZip = pZip;
+    state.m_cur_archive_file_ofs = cur_archive_file_ofs;
+    state.m_comp_size = 0;
+
+    if (!mz_zip_writer_add_lz4_blocks(&state, pLz4_comp, pBuf, buf_size))
+    {
+      pZip->m_pFree(pZip->m_pAlloc_opaque, pLz4_comp);
+      return MZ_FALSE;
+    }
+
+    comp_size = state.m_comp_size;
+    cur_archive_file_ofs = state.m_cur_archive_file_ofs;
+
+    method = MZ_LZ4;
   }
   else if (buf_size)
   {
@@ -3617,15 +4271,10 @@ mz_bool mz_zip_writer_add_mem_ex(mz_zip_archive *pZip, const char *pArchive_name
 
   pZip->m_pFree(pZip->m_pAlloc_opaque, pComp);
   pComp = NULL;
+  pZip->m_pFree(pZip->m_pAlloc_opaque, pLz4_comp);
+  pLz4_comp = NULL;
 
-  // no zip64 support yet
-  if ((comp_size > 0xFFFFFFFF) || (cur_archive_file_ofs > 0xFFFFFFFF))
-    return MZ_FALSE;
-
-  if (!mz_zip_writer_create_local_dir_header(pZip, local_dir_header, (mz_uint16)archive_name_size, 0, uncomp_size, comp_size, uncomp_crc32, method, 0, dos_time, dos_date))
-    return MZ_FALSE;
-
-  if (pZip->m_pWrite(pZip->m_pIO_opaque, local_dir_header_ofs, local_dir_header, sizeof(local_dir_header)) != sizeof(local_dir_header))
+  if (!mz_zip_writer_write_local_dir_header(pZip, local_dir_header_ofs, (mz_uint16)archive_name_size, zip64, uncomp_size, comp_size, uncomp_crc32, method, 0, dos_time, dos_date))
     return MZ_FALSE;
 
   if (!mz_zip_writer_add_to_central_dir(pZip, pArchive_name, (mz_uint16)archive_name_size, NULL, 0, pComment, comment_size, uncomp_size, comp_size, uncomp_crc32, method, 0, dos_time, dos_date, local_dir_header_ofs, ext_attributes))
@@ -3646,12 +4295,13 @@ mz_bool mz_zip_writer_add_file(mz_zip_archive *pZip, const char *pArchive_name,
   size_t archive_name_size;
   mz_uint8 local_dir_header[MZ_ZIP_LOCAL_DIR_HEADER_SIZE];
   MZ_FILE *pSrc_file = NULL;
+  mz_bool zip64;
 
   if ((int)level_and_flags < 0)
     level_and_flags = MZ_DEFAULT_LEVEL;
   level = level_and_flags & 0xF;
 
-  if ((!pZip) || (!pZip->m_pState) || (pZip->m_zip_mode != MZ_ZIP_MODE_WRITING) || (!pArchive_name) || ((comment_size) && (!pComment)) || (level > MZ_UBER_COMPRESSION))
+  if ((!pZip) || (!pZip->m_pState) || (pZip->m_zip_mode != MZ_ZIP_MODE_WRITING) || (!pArchive_name) || ((comment_size) && (!pComment)) || (pZip->m_total_files == MZ_ZIP32_MAX_FIELD_VALUE) || (level > MZ_UBER_COMPRESSION))
     return MZ_FALSE;
   if (level_and_flags & MZ_ZIP_FLAG_COMPRESSED_DATA)
     return MZ_FALSE;
@@ -3664,10 +4314,6 @@ mz_bool mz_zip_writer_add_file(mz_zip_archive *pZip, const char *pArchive_name,
 
   num_alignment_padding_bytes = mz_zip_writer_compute_padding_needed_for_file_alignment(pZip);
 
-  // no zip64 support yet
-  if ((pZip->m_total_files == 0xFFFF) || ((pZip->m_archive_size + num_alignment_padding_bytes + MZ_ZIP_LOCAL_DIR_HEADER_SIZE + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + comment_size + archive_name_size) > 0xFFFFFFFF))
-    return MZ_FALSE;
-
   if (!mz_zip_get_file_modified_time(pSrc_filename, &dos_time, &dos_date))
     return MZ_FALSE;
     
@@ -3678,12 +4324,7 @@ mz_bool mz_zip_writer_add_file(mz_zip_archive *pZip, const char *pArchive_name,
   uncomp_size = MZ_FTELL64(pSrc_file);
   MZ_FSEEK64(pSrc_file, 0, SEEK_SET);
 
-  if (uncomp_size > 0xFFFFFFFF)
-  {
-    // No zip64 support yet
-    MZ_FCLOSE(pSrc_file);
-    return MZ_FALSE;
-  }
+  zip64 = mz_zip_writer_size_may_need_zip64(uncomp_size);
   if (uncomp_size <= 3)
     level = 0;
 
@@ -3704,6 +4345,17 @@ mz_bool mz_zip_writer_add_file(mz_zip_archive *pZip, const char *pArchive_name,
   }
   cur_archive_file_ofs += archive_name_size;
 
+  if (zip64)
+  {
+    // Reserve the zip64 local extra field, it's filled in along with the local header once the sizes are known.
+    if (!mz_zip_writer_write_zeros(pZip, cur_archive_file_ofs, MZ_ZIP64_LOCAL_EXTRA_FIELD_SIZE))
+    {
+      MZ_FCLOSE(pSrc_file);
+      return MZ_FALSE;
+    }
+    cur_archive_file_ofs += MZ_ZIP64_LOCAL_EXTRA_FIELD_SIZE;
+  }
+
   if (uncomp_size)
   {
     mz_uint64 uncomp_remaining = uncomp_size;
@@ -3731,6 +4383,43 @@ mz_bool mz_zip_writer_add_file(mz_zip_archive *pZip, const char *pArchive_name,
       }
       comp_size = uncomp_size;
     }
+    else if (level_and_flags & MZ_ZIP_FLAG_COMPRESS_LZ4)
+    {
+      mz_zip_writer_add_state state;
+      mz_zip_writer_lz4_compressor *pComp = (mz_zip_writer_lz4_compressor *)pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, sizeof(mz_zip_writer_lz4_compressor));
+      if (!pComp)
+      {
+        pZip->m_pFree(pZip->m_pAlloc_opaque, pRead_buf);
+        MZ_FCLOSE(pSrc_file);
+        return MZ_FALSE;
+      }
+
+      state.m_pZip = pZip;
+      state.m_cur_archive_file_ofs = cur_archive_file_ofs;
+      state.m_comp_size = 0;
+
+      // MZ_ZIP_MAX_IO_BUF_SIZE is a multiple of MZ_LZ4_BLOCK_SIZE, so only the last read can end in a partial block.
+      while (uncomp_remaining)
+      {
+        size_t in_buf_size = (mz_uint32)MZ_MIN(uncomp_remaining, MZ_ZIP_MAX_IO_BUF_SIZE);
+        if ((MZ_FREAD(pRead_buf, 1, in_buf_size, pSrc_file) != in_buf_size) || (!mz_zip_writer_add_lz4_blocks(&state, pComp, pRead_buf, in_buf_size)))
+        {
+          pZip->m_pFree(pZip->m_pAlloc_opaque, pComp);
+          pZip->m_pFree(pZip->m_pAlloc_opaque, pRead_buf);
+          MZ_FCLOSE(pSrc_file);
+          return MZ_FALSE;
+        }
+        uncomp_crc32 = (mz_uint32)mz_crc32(uncomp_crc32, (const mz_uint8 *)pRead_buf, in_buf_size);
+        uncomp_remaining -= in_buf_size;
+      }
+
+      pZip->m_pFree(pZip->m_pAlloc_opaque, pComp);
+
+      comp_size = state.m_comp_size;
+      cur_archive_file_ofs = state.m_cur_archive_file_ofs;
+
+      method = MZ_LZ4;
+    }
     else
     {
       mz_bool result = MZ_FALSE;
@@ -3796,14 +4485,7 @@ mz_bool mz_zip_writer_add_file(mz_zip_archive *pZip, const char *pArchive_name,
 
   MZ_FCLOSE(pSrc_file); pSrc_file = NULL;
 
-  // no zip64 support yet
-  if ((comp_size > 0xFFFFFFFF) || (cur_archive_file_ofs > 0xFFFFFFFF))
-    return MZ_FALSE;
-
-  if (!mz_zip_writer_create_local_dir_header(pZip, local_dir_header, (mz_uint16)archive_name_size, 0, uncomp_size, comp_size, uncomp_crc32, method, 0, dos_time, dos_date))
-    return MZ_FALSE;
-
-  if (pZip->m_pWrite(pZip->m_pIO_opaque, local_dir_header_ofs, local_dir_header, sizeof(local_dir_header)) != sizeof(local_dir_header))
+  if (!mz_zip_writer_write_local_dir_header(pZip, local_dir_header_ofs, (mz_uint16)archive_name_size, zip64, uncomp_size, comp_size, uncomp_crc32, method, 0, dos_time, dos_date))
     return MZ_FALSE;
 
   if (!mz_zip_writer_add_to_central_dir(pZip, pArchive_name, (mz_uint16)archive_name_size, NULL, 0, pComment, comment_size, uncomp_size, comp_size, uncomp_crc32, method, 0, dos_time, dos_date, local_dir_header_ofs, ext_attributes))
@@ -3816,30 +4498,48 @@ mz_bool mz_zip_writer_add_file(mz_zip_archive *pZip, const char *pArchive_name,
 }
 #endif // #ifndef MINIZ_NO_STDIO
 
+// Returns true if an extra field block contains a zip64 extended information field.
+static mz_bool mz_zip_extra_has_zip64_field(const mz_uint8 *pExtra, mz_uint extra_size)
+{
+  while (extra_size >= sizeof(mz_uint16) * 2)
+  {
+    mz_uint field_size = sizeof(mz_uint16) * 2 + MZ_READ_LE16(pExtra + sizeof(mz_uint16));
+    if (field_size > extra_size)
+      break;
+    if (MZ_READ_LE16(pExtra) == MZ_ZIP64_EXTENDED_INFORMATION_FIELD_HEADER_ID)
+      return MZ_TRUE;
+    pExtra += field_size; extra_size -= field_size;
+  }
+  return MZ_FALSE;
+}
+
 mz_bool mz_zip_writer_add_from_zip_reader(mz_zip_archive *pZip, mz_zip_archive *pSource_zip, mz_uint file_index)
 {
-  mz_uint n, bit_flags, num_alignment_padding_bytes;
-  mz_uint64 comp_bytes_remaining, local_dir_header_ofs;
+  mz_uint n, bit_flags, num_alignment_padding_bytes, src_filename_size, src_extra_size, src_comment_size, dst_extra_size, zip64_extra_size = 0, local_extra_size;
+  mz_uint64 comp_bytes_remaining, local_dir_header_ofs, src_comp_size, src_uncomp_size, src_local_header_ofs;
   mz_uint64 cur_src_file_ofs, cur_dst_file_ofs;
   mz_uint32 local_header_u32[(MZ_ZIP_LOCAL_DIR_HEADER_SIZE + sizeof(mz_uint32) - 1) / sizeof(mz_uint32)]; mz_uint8 *pLocal_header = (mz_uint8 *)local_header_u32;
   mz_uint8 central_header[MZ_ZIP_CENTRAL_DIR_HEADER_SIZE];
+  mz_uint8 zip64_extra_data[MZ_ZIP64_MAX_CENTRAL_EXTRA_FIELD_SIZE];
   size_t orig_central_dir_size;
   mz_zip_internal_state *pState;
-  void *pBuf; const mz_uint8 *pSrc_central_header;
+  mz_bool local_zip64;
+  void *pBuf; const mz_uint8 *pSrc_central_header, *pSrc_extra;
 
   if ((!pZip) || (!pZip->m_pState) || (pZip->m_zip_mode != MZ_ZIP_MODE_WRITING))
     return MZ_FALSE;
   if (NULL == (pSrc_central_header = mz_zip_reader_get_cdh(pSource_zip, file_index)))
     return MZ_FALSE;
+  if (!mz_zip_reader_get_cdh_sizes(pSrc_central_header, &src_comp_size, &src_uncomp_size, &src_local_header_ofs))
+    return MZ_FALSE;
   pState = pZip->m_pState;
 
-  num_alignment_padding_bytes = mz_zip_writer_compute_padding_needed_for_file_alignment(pZip);
-
-  // no zip64 support yet
-  if ((pZip->m_total_files == 0xFFFF) || ((pZip->m_archive_size + num_alignment_padding_bytes + MZ_ZIP_LOCAL_DIR_HEADER_SIZE + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE) > 0xFFFFFFFF))
+  if (pZip->m_total_files == MZ_ZIP32_MAX_FIELD_VALUE)
     return MZ_FALSE;
 
-  cur_src_file_ofs = MZ_READ_LE32(pSrc_central_header + MZ_ZIP_CDH_LOCAL_HEADER_OFS);
+  num_alignment_padding_bytes = mz_zip_writer_compute_padding_needed_for_file_alignment(pZip);
+
+  cur_src_file_ofs = src_local_header_ofs;
   cur_dst_file_ofs = pZip->m_archive_size;
 
   if (pSource_zip->m_pRead(pSource_zip->m_pIO_opaque, cur_src_file_ofs, pLocal_header, MZ_ZIP_LOCAL_DIR_HEADER_SIZE) != MZ_ZIP_LOCAL_DIR_HEADER_SIZE)
@@ -3859,11 +4559,28 @@ mz_bool mz_zip_writer_add_from_zip_reader(mz_zip_archive *pZip, mz_zip_archive *
   cur_dst_file_ofs += MZ_ZIP_LOCAL_DIR_HEADER_SIZE;
 
   n = MZ_READ_LE16(pLocal_header + MZ_ZIP_LDH_FILENAME_LEN_OFS) + MZ_READ_LE16(pLocal_header + MZ_ZIP_LDH_EXTRA_LEN_OFS);
-  comp_bytes_remaining = n + MZ_READ_LE32(pSrc_central_header + MZ_ZIP_CDH_COMPRESSED_SIZE_OFS);
+  comp_bytes_remaining = n + src_comp_size;
 
-  if (NULL == (pBuf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, (size_t)MZ_MAX(sizeof(mz_uint32) * 4, MZ_MIN(MZ_ZIP_MAX_IO_BUF_SIZE, comp_bytes_remaining)))))
+  if (NULL == (pBuf = pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, (size_t)MZ_MAX(MZ_ZIP_DATA_DESCRIPTOR_SIZE64, MZ_MIN(MZ_ZIP_MAX_IO_BUF_SIZE, comp_bytes_remaining)))))
     return MZ_FALSE;
 
+  // A zip64 local extra field means any data descriptor uses 64-bit sizes. The filename and extra field together can be bigger than the copy buffer, so the extra field is read on its own.
+  local_zip64 = MZ_FALSE;
+  local_extra_size = MZ_READ_LE16(pLocal_header + MZ_ZIP_LDH_EXTRA_LEN_OFS);
+  if (local_extra_size)
+  {
+    mz_uint8 *pLocal_extra = (mz_uint8 *)pZip->m_pAlloc(pZip->m_pAlloc_opaque, 1, local_extra_size);
+    if ((!pLocal_extra) || (pSource_zip->m_pRead(pSource_zip->m_pIO_opaque, cur_src_file_ofs + MZ_READ_LE16(pLocal_header + MZ_ZIP_LDH_FILENAME_LEN_OFS), pLocal_extra, local_extra_size) != local_extra_size))
+    {
+      if (pLocal_extra)
+        pZip->m_pFree(pZip->m_pAlloc_opaque, pLocal_extra);
+      pZip->m_pFree(pZip->m_pAlloc_opaque, pBuf);
+      return MZ_FALSE;
+    }
+    local_zip64 = mz_zip_extra_has_zip64_field(pLocal_extra, local_extra_size);
+    pZip->m_pFree(pZip->m_pAlloc_opaque, pLocal_extra);
+  }
+
   while (comp_bytes_remaining)
   {
     n = (mz_uint)MZ_MIN(MZ_ZIP_MAX_IO_BUF_SIZE, comp_bytes_remaining);
@@ -3887,14 +4604,15 @@ mz_bool mz_zip_writer_add_from_zip_reader(mz_zip_archive *pZip, mz_zip_archive *
   bit_flags = MZ_READ_LE16(pLocal_header + MZ_ZIP_LDH_BIT_FLAG_OFS);
   if (bit_flags & 8)
   {
-    // Copy data descriptor
-    if (pSource_zip->m_pRead(pSource_zip->m_pIO_opaque, cur_src_file_ofs, pBuf, sizeof(mz_uint32) * 4) != sizeof(mz_uint32) * 4)
+    // Copy data descriptor. The signature is optional, and the sizes are 64-bit for zip64 entries.
+    mz_uint descriptor_size = (local_zip64 || (src_comp_size >= MZ_ZIP32_MAX_FIELD_VALUE) || (src_uncomp_size >= MZ_ZIP32_MAX_FIELD_VALUE)) ? MZ_ZIP_DATA_DESCRIPTOR_SIZE64 : MZ_ZIP_DATA_DESCRIPTOR_SIZE32;
+    if (pSource_zip->m_pRead(pSource_zip->m_pIO_opaque, cur_src_file_ofs, pBuf, descriptor_size) != descriptor_size)
     {
       pZip->m_pFree(pZip->m_pAlloc_opaque, pBuf);
       return MZ_FALSE;
     }
 
-    n = sizeof(mz_uint32) * ((MZ_READ_LE32(pBuf) == 0x08074b50) ? 4 : 3);
+    n = (MZ_READ_LE32(pBuf) == MZ_ZIP_DATA_DESCRIPTOR_ID) ? descriptor_size : (descriptor_size - sizeof(mz_uint32));
     if (pZip->m_pWrite(pZip->m_pIO_opaque, cur_dst_file_ofs, pBuf, n) != n)
     {
       pZip->m_pFree(pZip->m_pAlloc_opaque, pBuf);
@@ -3906,25 +4624,66 @@ mz_bool mz_zip_writer_add_from_zip_reader(mz_zip_archive *pZip, mz_zip_archive *
   }
   pZip->m_pFree(pZip->m_pAlloc_opaque, pBuf);
 
-  // no zip64 support yet
-  if (cur_dst_file_ofs > 0xFFFFFFFF)
+  // Rebuild the central directory record: the source's zip64 field (if any) is replaced with one matching the entry's new local header offset.
+  src_filename_size = MZ_READ_LE16(pSrc_central_header + MZ_ZIP_CDH_FILENAME_LEN_OFS);
+  src_extra_size = MZ_READ_LE16(pSrc_central_header + MZ_ZIP_CDH_EXTRA_LEN_OFS);
+  src_comment_size = MZ_READ_LE16(pSrc_central_header + MZ_ZIP_CDH_COMMENT_LEN_OFS);
+  pSrc_extra = pSrc_central_header + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE + src_filename_size;
+
+  if ((src_uncomp_size >= MZ_ZIP32_MAX_FIELD_VALUE) || (src_comp_size >= MZ_ZIP32_MAX_FIELD_VALUE) || (local_dir_header_ofs >= MZ_ZIP32_MAX_FIELD_VALUE))
+  {
+    zip64_extra_size = mz_zip_writer_create_zip64_extra_data(zip64_extra_data,
+      (src_uncomp_size >= MZ_ZIP32_MAX_FIELD_VALUE) ? &src_uncomp_size : NULL,
+      (src_comp_size >= MZ_ZIP32_MAX_FIELD_VALUE) ? &src_comp_size : NULL,
+      (local_dir_header_ofs >= MZ_ZIP32_MAX_FIELD_VALUE) ? &local_dir_header_ofs : NULL);
+  }
+
+  dst_extra_size = zip64_extra_size;
+  for (n = 0; n + sizeof(mz_uint16) * 2 <= src_extra_size; )
+  {
+    mz_uint field_size = sizeof(mz_uint16) * 2 + MZ_READ_LE16(pSrc_extra + n + sizeof(mz_uint16));
+    if (MZ_READ_LE16(pSrc_extra + n) != MZ_ZIP64_EXTENDED_INFORMATION_FIELD_HEADER_ID)
+      dst_extra_size += field_size;
+    n += field_size;
+  }
+  if (dst_extra_size > 0xFFFF)
     return MZ_FALSE;
 
   orig_central_dir_size = pState->m_central_dir.m_size;
 
   memcpy(central_header, pSrc_central_header, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE);
-  MZ_WRITE_LE32(central_header + MZ_ZIP_CDH_LOCAL_HEADER_OFS, local_dir_header_ofs);
-  if (!mz_zip_array_push_back(pZip, &pState->m_central_dir, central_header, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE))
+  MZ_WRITE_LE32(central_header + MZ_ZIP_CDH_COMPRESSED_SIZE_OFS, MZ_ZIP32_FIELD(src_comp_size));
+  MZ_WRITE_LE32(central_header + MZ_ZIP_CDH_DECOMPRESSED_SIZE_OFS, MZ_ZIP32_FIELD(src_uncomp_size));
+  MZ_WRITE_LE32(central_header + MZ_ZIP_CDH_LOCAL_HEADER_OFS, MZ_ZIP32_FIELD(local_dir_header_ofs));
+  MZ_WRITE_LE16(central_header + MZ_ZIP_CDH_EXTRA_LEN_OFS, dst_extra_size);
+  if ((zip64_extra_size) && (MZ_READ_LE16(central_header + MZ_ZIP_CDH_VERSION_NEEDED_OFS) < 45))
+    MZ_WRITE_LE16(central_header + MZ_ZIP_CDH_VERSION_NEEDED_OFS, 45);
+  if ((!mz_zip_array_push_back(pZip, &pState->m_central_dir, central_header, MZ_ZIP_CENTRAL_DIR_HEADER_SIZE)) ||
+      (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pSrc_central_header + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE, src_filename_size)) ||
+      (!mz_zip_array_push_back(pZip, &pState->m_central_dir, zip64_extra_data, zip64_extra_size)))
+  {
+    mz_zip_array_resize(pZip, &pState->m_central_dir, orig_central_dir_size, MZ_FALSE);
     return MZ_FALSE;
+  }
+
+  for (n = 0; n + sizeof(mz_uint16) * 2 <= src_extra_size; )
+  {
+    mz_uint field_size = sizeof(mz_uint16) * 2 + MZ_READ_LE16(pSrc_extra + n + sizeof(mz_uint16));
+    if ((MZ_READ_LE16(pSrc_extra + n) != MZ_ZIP64_EXTENDED_INFORMATION_FIELD_HEADER_ID) && (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pSrc_extra + n, field_size)))
+    {
+      mz_zip_array_resize(pZip, &pState->m_central_dir, orig_central_dir_size, MZ_FALSE);
+      return MZ_FALSE;
+    }
+    n += field_size;
+  }
 
-  n = MZ_READ_LE16(pSrc_central_header + MZ_ZIP_CDH_FILENAME_LEN_OFS) + MZ_READ_LE16(pSrc_central_header + MZ_ZIP_CDH_EXTRA_LEN_OFS) + MZ_READ_LE16(pSrc_central_header + MZ_ZIP_CDH_COMMENT_LEN_OFS);
-  if (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pSrc_central_header + MZ_ZIP_CENTRAL_DIR_HEADER_SIZE, n))
+  if (!mz_zip_array_push_back(pZip, &pState->m_central_dir, pSrc_extra + src_extra_size, src_comment_size))
   {
     mz_zip_array_resize(pZip, &pState->m_central_dir, orig_central_dir_size, MZ_FALSE);
     return MZ_FALSE;
   }
 
-  if (pState->m_central_dir.m_size > 0xFFFFFFFF)
+  if (pState->m_central_dir.m_size > MZ_ZIP32_MAX_FIELD_VALUE)
     return MZ_FALSE;
   n = (mz_uint32)orig_central_dir_size;
   if (!mz_zip_array_push_back(pZip, &pState->m_central_dir_offsets, &n, 1))
@@ -3950,10 +4709,6 @@ mz_bool mz_zip_writer_finalize_archive(mz_zip_archive *pZip)
 
   pState = pZip->m_pState;
 
-  // no zip64 support yet
-  if ((pZip->m_total_files > 0xFFFF) || ((pZip->m_archive_size + pState->m_central_dir.m_size + MZ_ZIP_END_OF_CENTRAL_DIR_HEADER_SIZE) > 0xFFFFFFFF))
-    return MZ_FALSE;
-
   central_dir_ofs = 0;
   central_dir_size = 0;
   if (pZip->m_total_files)
@@ -3967,13 +4722,35 @@ mz_bool mz_zip_writer_finalize_archive(mz_zip_archive *pZip)
     pZip->m_archive_size += central_dir_size;
   }
 
+  // Write the zip64 end of central directory record and its locator if any classic field would overflow
+  if ((pZip->m_total_files >= MZ_ZIP16_MAX_FIELD_VALUE) || (central_dir_size >= MZ_ZIP32_MAX_FIELD_VALUE) || (central_dir_ofs >= MZ_ZIP32_MAX_FIELD_VALUE))
+  {
+    mz_uint8 zip64_hdr[MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIZE + MZ_ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIZE];
+    mz_uint8 *pLocator = zip64_hdr + MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIZE;
+    MZ_CLEAR_OBJ(zip64_hdr);
+    MZ_WRITE_LE32(zip64_hdr + MZ_ZIP64_ECDH_SIG_OFS, MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIG);
+    MZ_WRITE_LE64(zip64_hdr + MZ_ZIP64_ECDH_SIZE_OF_RECORD_OFS, MZ_ZIP64_END_OF_CENTRAL_DIR_HEADER_SIZE - sizeof(mz_uint32) - sizeof(mz_uint64));
+    MZ_WRITE_LE16(zip64_hdr + MZ_ZIP64_ECDH_VERSION_MADE_BY_OFS, 45);
+    MZ_WRITE_LE16(zip64_hdr + MZ_ZIP64_ECDH_VERSION_NEEDED_OFS, 45);
+    MZ_WRITE_LE64(zip64_hdr + MZ_ZIP64_ECDH_CDIR_NUM_ENTRIES_ON_DISK_OFS, pZip->m_total_files);
+    MZ_WRITE_LE64(zip64_hdr + MZ_ZIP64_ECDH_CDIR_TOTAL_ENTRIES_OFS, pZip->m_total_files);
+    MZ_WRITE_LE64(zip64_hdr + MZ_ZIP64_ECDH_CDIR_SIZE_OFS, central_dir_size);
+    MZ_WRITE_LE64(zip64_hdr + MZ_ZIP64_ECDH_CDIR_OFS_OFS, central_dir_ofs);
+    MZ_WRITE_LE32(pLocator + MZ_ZIP64_ECDL_SIG_OFS, MZ_ZIP64_END_OF_CENTRAL_DIR_LOCATOR_SIG);
+    MZ_WRITE_LE64(pLocator + MZ_ZIP64_ECDL_REL_OFS_TO_ZIP64_ECDR_OFS, pZip->m_archive_size);
+    MZ_WRITE_LE32(pLocator + MZ_ZIP64_ECDL_TOTAL_NUMBER_OF_DISKS_OFS, 1);
+    if (pZip->m_pWrite(pZip->m_pIO_opaque, pZip->m_archive_size, zip64_hdr, sizeof(zip64_hdr)) != sizeof(zip64_hdr))
+      return MZ_FALSE;
+    pZip->m_archive_size += sizeof(zip64_hdr);
+  }
+
   // Write end of central directory record
   MZ_CLEAR_OBJ(hdr);
   MZ_WRITE_LE32(hdr + MZ_ZIP_ECDH_SIG_OFS, MZ_ZIP_END_OF_CENTRAL_DIR_HEADER_SIG);
-  MZ_WRITE_LE16(hdr + MZ_ZIP_ECDH_CDIR_NUM_ENTRIES_ON_DISK_OFS, pZip->m_total_files);
-  MZ_WRITE_LE16(hdr + MZ_ZIP_ECDH_CDIR_TOTAL_ENTRIES_OFS, pZip->m_total_files);
-  MZ_WRITE_LE32(hdr + MZ_ZIP_ECDH_CDIR_SIZE_OFS, central_dir_size);
-  MZ_WRITE_LE32(hdr + MZ_ZIP_ECDH_CDIR_OFS_OFS, central_dir_ofs);
+  MZ_WRITE_LE16(hdr + MZ_ZIP_ECDH_CDIR_NUM_ENTRIES_ON_DISK_OFS, MZ_MIN(pZip->m_total_files, MZ_ZIP16_MAX_FIELD_VALUE));
+  MZ_WRITE_LE16(hdr + MZ_ZIP_ECDH_CDIR_TOTAL_ENTRIES_OFS, MZ_MIN(pZip->m_total_files, MZ_ZIP16_MAX_FIELD_VALUE));
+  MZ_WRITE_LE32(hdr + MZ_ZIP_ECDH_CDIR_SIZE_OFS, MZ_ZIP32_FIELD(central_dir_size));
+  MZ_WRITE_LE32(hdr + MZ_ZIP_ECDH_CDIR_OFS_OFS, MZ_ZIP32_FIELD(central_dir_ofs));
 
   if (pZip->m_pWrite(pZip->m_pIO_opaque, pZip->m_archive_size, hdr, sizeof(hdr)) != sizeof(hdr))
     return MZ_FALSE;
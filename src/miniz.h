@@ -140,7 +140,7 @@
      possibility that the archive's central directory could be lost with this method if anything goes wrong, though.
 
      - ZIP archive support limitations:
-     No zip64 or spanning support. Extraction functions can only handle unencrypted, stored or deflated files.
+     Zip64 archives are supported, spanning is not. Extraction functions can only handle unencrypted, stored or deflated files.
      Requires streams capable of seeking.
 
    * This is a header file library, like stb_image.c. To get only a header file, either cut and paste the
@@ -229,6 +229,8 @@ enum { MZ_DEFAULT_STRATEGY = 0, MZ_FILTERED = 1, MZ_HUFFMAN_ONLY = 2, MZ_RLE = 3
 
 // Method
 #define MZ_DEFLATED 8
+// Zip method ID for entries stored as a series of LZ4 blocks (see the LZ4 block codec below). This ID isn't assigned by the zip appnote, only woomy packages use it.
+#define MZ_LZ4 0x4C34
 
 #ifndef MINIZ_NO_ZLIB_APIS
 
@@ -477,6 +479,7 @@ typedef int mz_bool;
 enum
 {
   MZ_ZIP_MAX_IO_BUF_SIZE = 128*1024*1024,
+  MZ_ZIP_STORED_BLOCK_SIZE = 1024*1024,
   MZ_ZIP_MAX_ARCHIVE_FILENAME_SIZE = 260,
   MZ_ZIP_MAX_ARCHIVE_FILE_COMMENT_SIZE = 256
 };
@@ -544,7 +547,10 @@ typedef enum
   MZ_ZIP_FLAG_CASE_SENSITIVE                = 0x0100,
   MZ_ZIP_FLAG_IGNORE_PATH                   = 0x0200,
   MZ_ZIP_FLAG_COMPRESSED_DATA               = 0x0400,
-  MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY = 0x0800
+  MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY = 0x0800,
+  MZ_ZIP_FLAG_COMPRESS_LZ4                  = 0x1000,
+  MZ_ZIP_FLAG_NO_CRC32_CHECK                = 0x2000,
+  MZ_ZIP_FLAG_POSITIONAL_READS              = 0x4000
 } mz_zip_flags;
 
 // ZIP archive reading
@@ -555,6 +561,8 @@ mz_bool mz_zip_reader_init(mz_zip_archive *pZip, mz_uint64 size, mz_uint32 flags
 mz_bool mz_zip_reader_init_mem(mz_zip_archive *pZip, const void *pMem, size_t size, mz_uint32 flags);
 
 #ifndef MINIZ_NO_STDIO
+// With MZ_ZIP_FLAG_POSITIONAL_READS the file is read with pread() instead of seeking a shared FILE, so several threads may extract entries from the same
+// archive at once (as long as nothing ends or modifies the archive meanwhile). Fails on platforms without pread().
 mz_bool mz_zip_reader_init_file(mz_zip_archive *pZip, const char *pFilename, mz_uint32 flags);
 #endif
 
@@ -590,12 +598,17 @@ void *mz_zip_reader_extract_to_heap(mz_zip_archive *pZip, mz_uint file_index, si
 void *mz_zip_reader_extract_file_to_heap(mz_zip_archive *pZip, const char *pFilename, size_t *pSize, mz_uint flags);
 
 // Extracts a archive file using a callback function to output the file's data.
+// Stored entries are passed to the callback in blocks of up to MZ_ZIP_STORED_BLOCK_SIZE bytes, read from block aligned archive offsets after the first one.
+// With MZ_ZIP_FLAG_NO_CRC32_CHECK the data isn't checksummed here, so a callback can compute the CRC itself (say on another core) and compare it against m_crc32.
 mz_bool mz_zip_reader_extract_to_callback(mz_zip_archive *pZip, mz_uint file_index, mz_file_write_func pCallback, void *pOpaque, mz_uint flags);
 mz_bool mz_zip_reader_extract_file_to_callback(mz_zip_archive *pZip, const char *pFilename, mz_file_write_func pCallback, void *pOpaque, mz_uint flags);
 
 #ifndef MINIZ_NO_STDIO
 // Extracts a archive file to a disk file and sets its last accessed and modified times.
 // This function only extracts files, not archive directory records.
+// When miniz.c is built with MINIZ_LINUX_COPY_FILE_RANGE on Linux, stored entries of archives opened with mz_zip_reader_init_file() are copied
+// inside the kernel with copy_file_range() or sendfile(),
+// and checksummed on a worker thread in the meantime (link with -pthread).
 mz_bool mz_zip_reader_extract_to_file(mz_zip_archive *pZip, mz_uint file_index, const char *pDst_filename, mz_uint flags);
 mz_bool mz_zip_reader_extract_file_to_file(mz_zip_archive *pZip, const char *pArchive_filename, const char *pDst_filename, mz_uint flags);
 #endif
@@ -626,6 +639,7 @@ mz_bool mz_zip_writer_init_from_reader(mz_zip_archive *pZip, const char *pFilena
 // Adds the contents of a memory buffer to an archive. These functions record the current local time into the archive.
 // To add a directory entry, call this method with an archive name ending in a forwardslash with empty buffer.
 // level_and_flags - compression level (0-10, see MZ_BEST_SPEED, MZ_BEST_COMPRESSION, etc.) logically OR'd with zero or more mz_zip_flags, or just set to MZ_DEFAULT_COMPRESSION.
+// With MZ_ZIP_FLAG_COMPRESS_LZ4 any non-zero level stores the data with the MZ_LZ4 method instead of deflate, which decompresses much faster at some cost in ratio.
 mz_bool mz_zip_writer_add_mem(mz_zip_archive *pZip, const char *pArchive_name, const void *pBuf, size_t buf_size, mz_uint level_and_flags);
 mz_bool mz_zip_writer_add_mem_ex(mz_zip_archive *pZip, const char *pArchive_name, const void *pBuf, size_t buf_size, const void *pComment, mz_uint16 comment_size, mz_uint level_and_flags, mz_uint64 uncomp_size, mz_uint32 uncomp_crc32);
 
@@ -904,6 +918,21 @@ mz_uint32 tdefl_get_adler32(tdefl_compressor *d);
 mz_uint tdefl_create_comp_flags_from_zip_params(int level, int window_bits, int strategy);
 #endif // #ifndef MINIZ_NO_ZLIB_APIS
 
+// ------------------- LZ4 block codec
+
+// An MZ_LZ4 zip entry is a series of blocks, each a little endian 32-bit header holding the payload size followed by the payload. Every block but the last decodes to
+// exactly MZ_LZ4_BLOCK_SIZE bytes and matches never reach into a previous block, so blocks can be decoded one at a time with fixed size buffers.
+// Blocks whose header has MZ_LZ4_BLOCK_STORED set hold raw bytes instead of an LZ4 block.
+enum { MZ_LZ4_BLOCK_SIZE = 65536, MZ_LZ4_BLOCK_HEADER_SIZE = 4, MZ_LZ4_HASH_BITS = 12, MZ_LZ4_HASH_SIZE = 1 << MZ_LZ4_HASH_BITS };
+#define MZ_LZ4_BLOCK_STORED 0x80000000U
+
+// Compresses up to MZ_LZ4_BLOCK_SIZE bytes into a raw LZ4 block. pHash_table is scratch space for MZ_LZ4_HASH_SIZE entries.
+// Returns the compressed size, or 0 if the compressed block doesn't fit in dst_len bytes.
+size_t mz_lz4_compress_block(const void *pSrc, size_t src_len, void *pDst, size_t dst_len, mz_uint16 *pHash_table);
+
+// Decompresses a raw LZ4 block. Returns the decompressed size, or -1 if the block is malformed or doesn't fit in dst_len bytes.
+int mz_lz4_decompress_block(const void *pSrc, size_t src_len, void *pDst, size_t dst_len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,329 @@
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+#include "ui.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
+#define MAX(a,b) (((a)>(b))?(a):(b))
+
+static LayoutItem *addItem(UILayout *layout, int screen, int type)
+{
+    ScreenLayout *view = &layout->screens[screen];
+    if(view->numItems == LAYOUT_ITEMS_MAX)
+        return NULL;
+    
+    LayoutItem *item = &view->items[view->numItems++];
+    memset(item, 0, sizeof(*item));
+    item->type = type;
+    return item;
+}
+
+static const char *formatText(UILayout *layout, const char *format, va_list args)
+{
+    u32 space = LAYOUT_TEXT_MAX - layout->textUsed;
+    char *text = layout->text + layout->textUsed;
+    int len = vsnprintf(text, space, format, args);
+    if(len < 0 || (u32)len >= space)
+        return NULL;
+    
+    layout->textUsed += len + 1;
+    return text;
+}
+
+static void putText(UILayout *layout, int screen, int x, int y, u8 r, u8 g, u8 b, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const char *text = formatText(layout, format, args);
+    va_end(args);
+    
+    LayoutItem *item = text ? addItem(layout, screen, LAYOUT_TEXT) : NULL;
+    if(!item)
+        return;
+    item->x1 = x;
+    item->y1 = y;
+    item->r = r;
+    item->g = g;
+    item->b = b;
+    item->text = text;
+}
+
+static void putCenteredText(UILayout *layout, int screen, int y, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    const char *text = formatText(layout, format, args);
+    va_end(args);
+    
+    LayoutItem *item = text ? addItem(layout, screen, LAYOUT_TEXT) : NULL;
+    if(!item)
+        return;
+    item->x1 = layout->screens[screen].width/2 - getStringWidth(text)/2;
+    item->y1 = y;
+    item->r = 255;
+    item->g = 255;
+    item->b = 255;
+    item->text = text;
+}
+
+static void putShape(UILayout *layout, int screen, int type, int x1, int y1, int x2, int y2, int arg, u8 r, u8 g, u8 b)
+{
+    LayoutItem *item = addItem(layout, screen, type);
+    if(!item)
+        return;
+    item->x1 = x1;
+    item->y1 = y1;
+    item->x2 = x2;
+    item->y2 = y2;
+    item->arg = arg;
+    item->r = r;
+    item->g = g;
+    item->b = b;
+}
+
+static void putSurface(UILayout *layout, int screen, int x, int y, Surface *surface)
+{
+    LayoutItem *item = addItem(layout, screen, LAYOUT_SURFACE);
+    if(!item)
+        return;
+    item->x1 = x;
+    item->y1 = y;
+    item->surface = surface;
+}
+
+//Both views start out the same way, just in their own border color
+static void layoutBackground(UILayout *layout, int screen, u8 r, u8 g, u8 b)
+{
+    ScreenLayout *view = &layout->screens[screen];
+    putShape(layout, screen, LAYOUT_FILL, 0, 0, 0, 0, 0, 0, 0, 0);
+    putShape(layout, screen, LAYOUT_RECT, 0, 0, view->width - 1, view->height - 1, 9, r, g, b);
+}
+
+//Button help goes at the bottom of whichever screen is in front of the user
+static void layoutControls(UILayout *layout, int screen, u8 r, u8 g, u8 b)
+{
+    int height = layout->screens[screen].height;
+    putText(layout, screen, 20, height-50, 255, 255, 255, "A:                     B:              Y:                   X: ");
+    putText(layout, screen, 20, height-50, r, g, b, "                          Exit Folder     Add FST to queue     Cancel Install");
+    putText(layout, screen, 20, height-60, r, g, b, "   Enter Folder");
+    putText(layout, screen, 20, height-40, r, g, b, "   Add Woomy to queue");
+}
+
+//Swap screen button, always on the gamepad
+static void layoutSwapButton(UILayout *layout, int screen, const UIState *ui)
+{
+    int width = layout->screens[screen].width;
+    u8 color = ui->buttonState ? 60 : 20;
+    putShape(layout, screen, LAYOUT_FILL_RECT, width-160, 20, width - 20, 80, 0, color, color, color);
+    putShape(layout, screen, LAYOUT_RECT, width-160, 20, width - 20, 80, 2, 128, 128, 128);
+    putText(layout, screen, width-140, 30, 255, 255, 255, " Swap");
+    putText(layout, screen, width-160, 50, 255, 255, 255, " Screens");
+}
+
+//Debug overlay with the frame scheduler's timings, drawn over whatever is in
+//the top right corner, or under the swap button when it's there
+static void layoutFrameStats(UILayout *layout, int screen, const UIState *ui)
+{
+    const FrameStats *stats = ui->frameStats;
+    int width = layout->screens[screen].width;
+    int x = width - 20 - 18*16;
+    int y = ui->screenSwap ? 90 : 20;
+    int lines = stats->skippingTV ? 3 : 2;
+    
+    putShape(layout, screen, LAYOUT_FILL_RECT, x - 4, y, width - 16, y + lines*20 + 2, 0, 0, 0, 0);
+    putText(layout, screen, x, y, 255, 255, 0, "%2d Hz %6.1f ms", stats->rate, stats->frameUs / 1000.0f);
+    putText(layout, screen, x, y + 20, 255, 255, 0, "draw %4.1f max %4.1f", stats->renderUs / 1000.0f, stats->renderMaxUs / 1000.0f);
+    if(stats->skippingTV)
+        putText(layout, screen, x, y + 40, 255, 255, 0, "TV at half rate");
+}
+
+static void layoutInfoScreen(UILayout *layout, int screen, const UIState *ui)
+{
+    int width = layout->screens[screen].width;
+    int height = layout->screens[screen].height;
+    int iconOffset = ui->hasIcon ? 110 : 0;
+    
+    layoutBackground(layout, screen, 0xC9, 0x34, 0x57);
+    
+    putCenteredText(layout, screen, 20, "Woom\xefnstaller");
+    putText(layout, screen, 20, 40, 255, 255, 255, "%s", ui->currentDirectory);
+    putText(layout, screen, 20, 60, 255, 255, 255, "Current Install Target: \x80\xFF\xAA\xAA%s%02u", ui->installDevices[ui->selectedInstallTarget].deviceName, ui->installDevices[ui->selectedInstallTarget].deviceNum);
+    
+    if(ui->installing)
+    {
+        //TODO: Show woomy metadata instead of TID?
+        putShape(layout, screen, LAYOUT_RECT, 30, 90, width - 30, 260+iconOffset, 2, 255, 255, 255);
+        
+        if(!ui->screenSwap)
+            putText(layout, screen, 42, 100, 255, 255, 255, "Installing \x80\xFF\xAA\xAA%016llX\x80\xFF\xFF\xFF from \x80\xFF\xAA\xAA%s", ui->installTid, ui->currentlyInstalling);
+        else
+            putText(layout, screen, 42, 100, 255, 255, 255, "Installing \x80\xFF\xAA\xAA%016llX", ui->installTid);
+            
+        putText(layout, screen, 42, 120, 255, 255, 255, "%llu of %llu bytes written", ui->sizeProgress, ui->sizeTotal);
+        putText(layout, screen, 42, 140, 255, 255, 255, "Installing content %u out of %u", ui->contentsProgress, ui->contentsTotal);
+        
+        putShape(layout, screen, LAYOUT_RECT, 40, 170+iconOffset, width - 40, 205+iconOffset, 2, 128, 128, 128);
+        if(ui->sizeProgress > 0)
+        {
+            float installPercent = ((float)ui->sizeProgress / (float)ui->sizeTotal)*100.0f;
+            float installPartPercent = ((float)ui->sizeProgress / (float)ui->sizeTotal);
+            putShape(layout, screen, LAYOUT_FILL_RECT, 40+4, 170+4+iconOffset, MAX(40+4, ((width - 40)-4)*installPartPercent), 205-4+iconOffset, 0, 255, 170, 170);
+            putCenteredText(layout, screen, 215+iconOffset, "%5.1f%% complete", installPercent);
+        }
+        
+        if(ui->hasIcon)
+        {
+            putSurface(layout, screen, width - 60 - 128, 130, ui->icon);
+        }
+    }
+    else if(ui->extracting)
+    {
+        putShape(layout, screen, LAYOUT_RECT, 30, 90, width - 30, 260+iconOffset, 2, 255, 255, 255);
+        
+        if(!ui->screenSwap)
+            putText(layout, screen, 42, 100, 255, 255, 255, "Preparing to install \x80\xFF\xAA\xAA%s\x80\xFF\xFF\xFF from \x80\xFF\xAA\xAA%s\x80\xFF\xFF\xFF", ui->entryName, ui->archiveName);
+        else
+            putText(layout, screen, 42, 100, 255, 255, 255, "Preparing to install \x80\xFF\xAA\xAA%s\x80\xFF\xFF\xFF", ui->entryName);
+            
+        putText(layout, screen, 42, 120, 255, 255, 255, "Unpacking contents %u of %u", ui->extractProg, ui->extractTotal);
+        putShape(layout, screen, LAYOUT_RECT, 40, 170+iconOffset, width - 40, 205+iconOffset, 2, 128, 128, 128);
+        //TODO: Maybe show extraction progress?
+        
+        if(ui->hasIcon)
+        {
+            putSurface(layout, screen, width - 60 - 128, 130, ui->icon);
+        }
+    }
+    else if(ui->numEntries > 0 && ui->entries[ui->selectedFile] != NULL)
+    {   
+        //An empty or unreadable directory has nothing to select
+        if(ui->entries[ui->selectedFile]->d_type == DT_DIR)
+            putText(layout, screen, 20, 100, 255, 170, 170, " %s/", ui->entries[ui->selectedFile]->d_name);
+        else
+            putText(layout, screen, 20, 100, 255, 170, 170, " %s", ui->entries[ui->selectedFile]->d_name);
+    }
+    
+    if(ui->installQueue[0] != NULL)
+    {
+        int yPos = 300+iconOffset;
+        int yLimit = ui->screenSwap ? height-40 : height-100;
+        putText(layout, screen, 20, yPos, 255, 255, 255, "Current install queue:");
+        for(int i = 0; i < INSTALL_QUEUE_SIZE; i++)
+        {
+            if(ui->installQueue[i] == NULL)
+                break;
+            
+            yPos += 20;
+            const InstallDevice *device = &ui->installDevices[ui->installQueueTarget[i]];
+            if(yPos >= yLimit && ui->installQueue[i+1] != NULL)
+                putText(layout, screen, 30, yPos, 255, 170, 170, "...");
+            else
+                putText(layout, screen, 30, yPos, 255, 170, 170, "%-41s -> %s%02u", ui->installQueue[i], device->deviceName, device->deviceNum);
+            if(yPos >= yLimit)
+                break;
+        }
+    }
+    
+    if(!ui->screenSwap)
+        layoutControls(layout, screen, 255, 170, 170);
+    else
+        layoutSwapButton(layout, screen, ui);
+    
+    if(ui->frameStats)
+        layoutFrameStats(layout, screen, ui);
+}
+
+static void layoutListScreen(UILayout *layout, int screen, const UIState *ui)
+{
+    int width = layout->screens[screen].width;
+    
+    layoutBackground(layout, screen, 4, 0x81, 0x88);
+    
+    //The rows move as a whole when scrolling, so the renderer can shift them
+    //instead of drawing each one again. Long names that run under the swap
+    //button just have it fall back to drawing everything.
+    int listRight = ui->screenSwap ? width - 10 : width - 161;
+    putShape(layout, screen, LAYOUT_LIST, 20, 20, listRight, 20 + ui->listLimit*20 - 1, ui->scrollPos*20, 0, 0, 0);
+    
+    int ypos = 20;
+    for(int i = ui->scrollPos; i < MIN(ui->scrollPos+ui->listLimit, ui->numEntries); i++)
+    {
+        if(ui->entries[i] == NULL)
+            continue;
+    
+        putText(layout, screen, 20, ypos, 0, 255, 255, " %s", ui->selectedFile == i ? ">" : " ");
+        if(ui->entries[i]->d_type == DT_DIR)
+            putText(layout, screen, 20, ypos, 255, 255, 255, "   %s/", ui->entries[i]->d_name);
+        else
+            putText(layout, screen, 20, ypos, 150, 255, 255, "   %s", ui->entries[i]->d_name);
+        
+        ypos += 20;
+    }
+    
+    if(!ui->screenSwap)
+        layoutSwapButton(layout, screen, ui);
+    else
+        layoutControls(layout, screen, 150, 255, 255);
+}
+
+void layoutUI(const UIState *ui, UILayout *layout)
+{
+    int infoScreen = ui->screenSwap ? SCREEN_BOTTOM : SCREEN_TOP;
+    int listScreen = ui->screenSwap ? SCREEN_TOP : SCREEN_BOTTOM;
+    
+    layout->screens[SCREEN_TOP].width = TV_WIDTH;
+    layout->screens[SCREEN_TOP].height = TV_HEIGHT;
+    layout->screens[SCREEN_BOTTOM].width = DRC_WIDTH;
+    layout->screens[SCREEN_BOTTOM].height = DRC_HEIGHT;
+    layout->screens[SCREEN_TOP].numItems = 0;
+    layout->screens[SCREEN_BOTTOM].numItems = 0;
+    layout->textUsed = 0;
+    
+    layoutInfoScreen(layout, infoScreen, ui);
+    layoutListScreen(layout, listScreen, ui);
+}
+
+//Where each screen's list was scrolled to the last time it was drawn
+static int lastListScroll[2];
+
+void drawLayout(const UILayout *layout, int screen)
+{
+    const ScreenLayout *view = &layout->screens[screen];
+    for(int i = 0; i < view->numItems; i++)
+    {
+        const LayoutItem *item = &view->items[i];
+        switch(item->type)
+        {
+            case LAYOUT_FILL:
+                fillScreen(item->r, item->g, item->b, 0);
+                break;
+            case LAYOUT_TEXT:
+                drawStringColor(item->x1, item->y1, (char*)item->text, item->r, item->g, item->b, 0);
+                break;
+            case LAYOUT_FILL_RECT:
+                drawFillRect(item->x1, item->y1, item->x2, item->y2, item->r, item->g, item->b, 0);
+                break;
+            case LAYOUT_RECT:
+                drawRectThickness(item->x1, item->y1, item->x2, item->y2, item->arg, item->r, item->g, item->b, 0);
+                break;
+            case LAYOUT_SURFACE:
+                drawSurface(item->x1, item->y1, item->surface);
+                break;
+            case LAYOUT_LIST:
+                scrollRegion(item->x1, item->y1, item->x2, item->y2, lastListScroll[screen] - item->arg);
+                lastListScroll[screen] = item->arg;
+                break;
+        }
+    }
+}
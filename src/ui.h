@@ -0,0 +1,116 @@
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+#ifndef UI_H
+#define UI_H
+#include <dirent.h>
+
+#include "draw.h"
+
+#define INSTALL_QUEUE_SIZE 0x100
+
+typedef struct InstallDevice
+{
+    int deviceID;
+    int deviceNum;
+    char *deviceName;
+} InstallDevice;
+
+//Timings the frame scheduler publishes for the debug overlay, refreshed a
+//couple of times a second so the overlay doesn't repaint every frame
+typedef struct FrameStats
+{
+    int rate;
+    u32 renderUs;
+    u32 renderMaxUs;
+    u32 frameUs;
+    bool skippingTV;
+} FrameStats;
+
+//Everything the two screens show, gathered once a frame so drawing doesn't
+//touch installer globals directly
+typedef struct UIState
+{
+    bool screenSwap;
+    bool buttonState;
+    int listLimit;
+    int scrollPos;
+    int selectedFile;
+    int numEntries;
+    struct dirent **entries;
+    char *currentDirectory;
+    const InstallDevice *installDevices;
+    int selectedInstallTarget;
+    char **installQueue;
+    const u8 *installQueueTarget;
+    
+    bool installing;
+    u64 installTid;
+    u64 sizeProgress;
+    u64 sizeTotal;
+    u32 contentsProgress;
+    u32 contentsTotal;
+    char *currentlyInstalling;
+    
+    bool extracting;
+    char *entryName;
+    char *archiveName;
+    int extractProg;
+    int extractTotal;
+    
+    bool hasIcon;
+    Surface *icon;
+    
+    const FrameStats *frameStats;
+} UIState;
+
+//Both screens laid out once a frame, with every string already formatted and
+//every position worked out for the size of the screen it ends up on. Each
+//screen then just draws its items.
+#define LAYOUT_ITEMS_MAX 160
+#define LAYOUT_TEXT_MAX 0x4000
+
+#define LAYOUT_FILL      0
+#define LAYOUT_TEXT      1
+#define LAYOUT_FILL_RECT 2
+#define LAYOUT_RECT      3
+#define LAYOUT_SURFACE   4
+#define LAYOUT_LIST      5
+
+typedef struct LayoutItem
+{
+    int type;
+    int x1, y1, x2, y2;
+    //Rect thickness, or for the list how far it's scrolled in pixels
+    int arg;
+    u8 r, g, b;
+    const char *text;
+    Surface *surface;
+} LayoutItem;
+
+typedef struct ScreenLayout
+{
+    int width;
+    int height;
+    LayoutItem items[LAYOUT_ITEMS_MAX];
+    int numItems;
+} ScreenLayout;
+
+//Indexed by SCREEN_TOP and SCREEN_BOTTOM. Item text points into the pool.
+typedef struct UILayout
+{
+    ScreenLayout screens[2];
+    char text[LAYOUT_TEXT_MAX];
+    u32 textUsed;
+} UILayout;
+
+void layoutUI(const UIState *ui, UILayout *layout);
+void drawLayout(const UILayout *layout, int screen);
+#endif /* UI_H */
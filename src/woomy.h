@@ -0,0 +1,75 @@
+/*
+ *  woomïnstaller - Homebrew package installer for Wii U
+ *
+ *  Copyright (C) 2016          SALT
+ *  Copyright (C) 2016          Max Thomas (Shiny Quagsire) <mtinc2@gmail.com>
+ *
+ *  This code is licensed under the terms of the GNU LGPL, version 2.1
+ *  see file LICENSE.md or https://www.gnu.org/licenses/lgpl-2.1.txt
+ */
+
+#ifndef WOOMY_H
+#define WOOMY_H
+#include <wut_types.h>
+
+//metadata.bin is an optional precompiled copy of metadata.xml which packers can store next to
+//it, so the installer doesn't have to parse XML. Every field is big endian, the console's own
+//byte order, and every offset is from the start of the blob. The layout is:
+//
+//  WoomyBinHeader
+//  WoomyBinEntry[numEntries], at entriesOffset
+//  WoomyBinFile[numFiles], at filesOffset, each entry's files are one contiguous run
+//  string table, at stringsOffset, null terminated strings that the name offsets index into
+//
+//entriesOffset and filesOffset have to be 8 byte aligned and the string table has to end with
+//a null terminator. Packages with an old or mismatched blob fall back to metadata.xml.
+#define WOOMY_BIN_MAGIC     0x574F4F4D //"WOOM"
+#define WOOMY_BIN_VERSION   1
+
+#define WOOMY_BIN_FLAG_ICON 0x1 //icon.tga is present, same as <icon>1</icon>
+
+typedef struct WoomyBinHeader WoomyBinHeader;
+struct WoomyBinHeader
+{
+    u32 magic;
+    u32 version;
+    u32 flags;
+    u32 nameOffset;         //archive name in the string table
+    u32 numEntries;
+    u32 entriesOffset;
+    u32 numFiles;
+    u32 filesOffset;
+    u32 stringsOffset;
+    u32 stringsSize;
+};
+
+typedef struct WoomyBinEntry WoomyBinEntry;
+struct WoomyBinEntry
+{
+    u32 nameOffset;         //entry name in the string table
+    u32 folderOffset;       //folder prefix in the string table, including the trailing slash
+    u32 count;              //number of .app contents, same as the entries attribute
+    u32 firstFile;          //index of the entry's first WoomyBinFile
+    u32 numFiles;
+    u32 reserved;
+    u64 compTotal;          //sum of the entry's compressed file sizes
+    u64 uncompTotal;        //sum of the entry's uncompressed file sizes
+};
+
+typedef struct WoomyBinFile WoomyBinFile;
+struct WoomyBinFile
+{
+    u32 fileIndex;          //index in the zip central directory
+    u32 reserved;
+    u64 localHeaderOffset;  //checked against the central directory to catch stale blobs
+};
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define WOOMY_BE32(x) __builtin_bswap32(x)
+#define WOOMY_BE64(x) __builtin_bswap64(x)
+#else
+#define WOOMY_BE32(x) (x)
+#define WOOMY_BE64(x) (x)
+#endif
+
+#endif /* WOOMY_H */